@@ -0,0 +1,41 @@
+#ifndef LD42_BENCH_BENCH_HPP
+#define LD42_BENCH_BENCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+
+namespace bench {
+
+// Runs `run` the given number of times and returns the fastest run in milliseconds.
+// Setup that should not be timed goes in `prepare`, which runs before each run.
+template <typename Prepare, typename Run>
+double best_of(int runs, Prepare&& prepare, Run&& run) {
+    using clock = std::chrono::steady_clock;
+    auto best = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < runs; ++i) {
+        prepare();
+        auto start = clock::now();
+        run();
+        auto elapsed = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+        best = std::min(best, elapsed);
+    }
+    return best;
+}
+
+template <typename Run>
+double best_of(int runs, Run&& run) {
+    return best_of(runs, [] {}, run);
+}
+
+inline void report(const std::string& name, double ms) {
+    std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << ms << " ms" << std::endl;
+}
+
+} //namespace bench
+
+#endif //LD42_BENCH_BENCH_HPP
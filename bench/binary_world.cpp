@@ -0,0 +1,81 @@
+// Saving and loading a world with the binary serializer, against building the JSON DOM with
+// serialize_entity for the same entities.
+
+#include "bench.hpp"
+
+#include "binary_serializer.hpp"
+#include "component_scripting.hpp"
+#include "components.hpp"
+#include "entities.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using world_components = utility::type_list<
+    component::position,
+    component::velocity,
+    component::aabb,
+    component::script,
+    component::animation,
+    component::block>;
+
+void populate(ember_database& db, int count) {
+    for (int i = 0; i < count; ++i) {
+        auto eid = db.create_entity();
+        db.create_component(eid, component::position{float(i % 100), float(i / 100)});
+        db.create_component(eid, component::aabb{-0.5f, 0.5f, -0.5f, 0.5f});
+        db.create_component(eid, component::block{i % 7});
+        if (i % 2 == 0) {
+            db.create_component(eid, component::velocity{1, -1});
+        }
+        if (i % 10 == 0) {
+            db.create_component(eid, component::script{"block"});
+            db.create_component(eid, component::animation{"block", "idle"});
+        }
+    }
+}
+
+} //namespace
+
+int main(int argc, char* argv[]) {
+    auto count = argc > 1 ? std::atoi(argv[1]) : 10000;
+    auto runs = 20;
+
+    auto db = ember_database{};
+    populate(db, count);
+
+    std::cout << count << " entities" << std::endl;
+
+    auto bytes = std::vector<std::byte>{};
+    bench::report("binary save", bench::best_of(runs, [&] {
+        bytes = binary::save_world(db, world_components{});
+    }));
+    std::cout << "binary size: " << bytes.size() << " bytes" << std::endl;
+
+    auto loaded = std::unique_ptr<ember_database>{};
+    bench::report("binary load", bench::best_of(runs, [&] {
+        loaded = std::make_unique<ember_database>();
+    }, [&] {
+        binary::load_world(*loaded, bytes, world_components{});
+    }));
+
+    auto json = nlohmann::json::array();
+    bench::report("serialize_entity DOM", bench::best_of(runs, [&] {
+        json = nlohmann::json::array();
+        db.visit([&](ember_database::ent_id eid) {
+            json.push_back(db.serialize_entity<
+                component::position,
+                component::velocity,
+                component::aabb,
+                component::script,
+                component::animation,
+                component::block>(eid));
+        });
+    }));
+    std::cout << "JSON size: " << json.dump().size() << " bytes" << std::endl;
+}
@@ -0,0 +1,152 @@
+// Broadphase pair finding in both modes, checked against brute force and timed from 1k to 50k boxes.
+
+#include "bench.hpp"
+
+#include "broadphase.hpp"
+#include "components.hpp"
+#include "entities.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using pair_set = std::set<std::pair<std::uint32_t, std::uint32_t>>;
+
+std::pair<std::uint32_t, std::uint32_t> make_key(ember_database::ent_id a, ember_database::ent_id b) {
+    return std::minmax(a.get_index(), b.get_index());
+}
+
+pair_set brute_force(ember_database& db) {
+    auto boxes = std::vector<std::pair<ember_database::ent_id, component::aabb>>();
+    db.visit([&](ember_database::ent_id eid, const component::position& pos, const component::aabb& box) {
+        boxes.push_back({eid, {pos.x + box.left, pos.x + box.right, pos.y + box.bottom, pos.y + box.top}});
+    });
+
+    auto pairs = pair_set();
+    for (auto i = std::size_t{0}; i < boxes.size(); ++i) {
+        for (auto j = i + 1; j < boxes.size(); ++j) {
+            const auto& a = boxes[i].second;
+            const auto& b = boxes[j].second;
+            if (std::max(a.left, b.left) < std::min(a.right, b.right) &&
+                std::max(a.bottom, b.bottom) < std::min(a.top, b.top)) {
+                pairs.insert(make_key(boxes[i].first, boxes[j].first));
+            }
+        }
+    }
+    return pairs;
+}
+
+void spawn(ember_database& db, glm::vec2 pos, component::aabb box) {
+    auto eid = db.create_entity();
+    db.create_component(eid, component::position{pos.x, pos.y});
+    db.create_component(eid, box);
+}
+
+// Moves, adds and removes boxes for a few frames, comparing every frame's pairs with brute force.
+bool check(const char* mode) {
+    auto db = ember_database{};
+    auto phase = broadphase(nlohmann::json{{"broadphase", mode}, {"cell_size", 2.0}});
+    auto rng = std::mt19937{1};
+    auto coord = std::uniform_real_distribution<float>(-50, 50);
+    auto extent = std::uniform_real_distribution<float>(0.1f, 3.f);
+
+    auto live = std::vector<ember_database::ent_id>();
+    auto add = [&](component::aabb box) {
+        spawn(db, {coord(rng), coord(rng)}, box);
+    };
+
+    for (int i = 0; i < 2000; ++i) {
+        add({-extent(rng), extent(rng), -extent(rng), extent(rng)});
+    }
+
+    for (int frame = 0; frame < 20; ++frame) {
+        db.visit([&](component::position& pos) {
+            pos.x += coord(rng) * 0.01f;
+            pos.y += coord(rng) * 0.01f;
+        });
+
+        if (frame % 3 == 0) {
+            live.clear();
+            db.visit([&](ember_database::ent_id eid, const component::aabb&) {
+                live.push_back(eid);
+            });
+            std::shuffle(live.begin(), live.end(), rng);
+            for (auto i = 0; i < 50; ++i) {
+                db.destroy_entity(live[i]);
+            }
+            db.destroy_component<component::aabb>(live[50]);
+            for (auto i = 0; i < 30; ++i) {
+                add({-1, 1, -1, 1});
+            }
+        }
+
+        phase.update(db);
+        auto out = std::vector<broadphase::pair>();
+        phase.find_pairs(out);
+
+        auto found = pair_set();
+        for (const auto& p : out) {
+            found.insert(make_key(p.eid1, p.eid2));
+        }
+
+        if (found.size() != out.size() || found != brute_force(db)) {
+            std::cerr << mode << ": pairs differ from brute force on frame " << frame << std::endl;
+            return false;
+        }
+
+        db.advance_change_tick();
+    }
+
+    return true;
+}
+
+// Unit boxes scattered at a density where each touches a few others, all moving every frame.
+void scaling(const char* mode, int count) {
+    auto db = ember_database{};
+    auto phase = broadphase(nlohmann::json{{"broadphase", mode}, {"cell_size", 2.0}});
+    auto rng = std::mt19937{2};
+    auto coord = std::uniform_real_distribution<float>(0, std::sqrt(float(count)) * 3);
+
+    for (int i = 0; i < count; ++i) {
+        spawn(db, {coord(rng), coord(rng)}, {-0.5f, 0.5f, -0.5f, 0.5f});
+    }
+    phase.update(db);
+
+    auto out = std::vector<broadphase::pair>();
+    auto ms = bench::best_of(10, [&] {
+        db.advance_change_tick();
+        db.visit([&](component::position& pos) {
+            pos.x += 0.01f;
+        });
+    }, [&] {
+        phase.update(db);
+        out.clear();
+        phase.find_pairs(out);
+    });
+
+    bench::report(std::string(mode) + " " + std::to_string(count) + " (" + std::to_string(out.size()) + " pairs)", ms);
+}
+
+} //namespace
+
+int main() {
+    for (auto mode : {"sap", "grid"}) {
+        if (!check(mode)) {
+            return EXIT_FAILURE;
+        }
+    }
+    std::cout << "Both modes match brute force." << std::endl;
+
+    for (auto mode : {"sap", "grid"}) {
+        for (auto count : {1000, 10000, 20000, 50000}) {
+            scaling(mode, count);
+        }
+    }
+}
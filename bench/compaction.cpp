@@ -0,0 +1,100 @@
+// Visits over a churned database before and after compaction, and the cost of compacting.
+
+#include "bench.hpp"
+
+#include "components.hpp"
+#include "entities.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Leaves about `count` entities with holes all over their component sets, like a long game would.
+std::unique_ptr<ember_database> make_churned(int count) {
+    auto db = std::make_unique<ember_database>();
+    auto rng = std::mt19937{42};
+    auto live = std::vector<ember_database::ent_id>();
+
+    auto spawn = [&] {
+        auto eid = db->create_entity();
+        db->create_component(eid, component::position{0, 0});
+        db->create_component(eid, component::velocity{1, 1});
+        live.push_back(eid);
+    };
+
+    for (int i = 0; i < count * 2; ++i) {
+        spawn();
+    }
+
+    for (int round = 0; round < 8; ++round) {
+        std::shuffle(live.begin(), live.end(), rng);
+        for (auto i = live.size() / 2; i < live.size(); ++i) {
+            db->destroy_entity(live[i]);
+        }
+        live.resize(live.size() / 2);
+        while (int(live.size()) < count) {
+            spawn();
+        }
+    }
+
+    return db;
+}
+
+void movement(ember_database& db) {
+    db.visit([](component::position& pos, const component::velocity& vel) {
+        pos.x += vel.vx;
+        pos.y += vel.vy;
+    });
+}
+
+} //namespace
+
+int main(int argc, char* argv[]) {
+    auto count = argc > 1 ? std::atoi(argv[1]) : 100000;
+    auto runs = 20;
+    auto rebuild_runs = 5;  // For runs that need a freshly churned database.
+
+    std::cout << count << " entities" << std::endl;
+
+    auto db = make_churned(count);
+    bench::report("visit, churned", bench::best_of(runs, [&] {
+        movement(*db);
+    }));
+
+    bench::report("compact", bench::best_of(rebuild_runs, [&] {
+        db = make_churned(count);
+    }, [&] {
+        db->compact();
+    }));
+
+    bench::report("visit, compacted", bench::best_of(runs, [&] {
+        movement(*db);
+    }));
+
+    // What the engine pays per tick with compact_each_tick, on a freshly churned database.
+    bench::report("compact_step", bench::best_of(rebuild_runs, [&] {
+        db = make_churned(count);
+    }, [&] {
+        db->compact_step();
+    }));
+
+    while (db->compact_step()) {
+    }
+    bench::report("visit, stepped until dense", bench::best_of(runs, [&] {
+        movement(*db);
+    }));
+
+    auto fresh = ember_database{};
+    for (int i = 0; i < count; ++i) {
+        auto eid = fresh.create_entity();
+        fresh.create_component(eid, component::position{0, 0});
+        fresh.create_component(eid, component::velocity{1, 1});
+    }
+    bench::report("visit, never churned", bench::best_of(runs, [&] {
+        movement(fresh);
+    }));
+}
@@ -0,0 +1,121 @@
+// net_id to ent_id lookups through paged_index, against the unordered_map it replaced, at several
+// database sizes.
+
+#include "bench.hpp"
+
+#include "components.hpp"
+#include "entities.hpp"
+#include "paged_index.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using net_id = ember_database::net_id;
+
+void run(int count) {
+    auto lookups = 1000000;
+    auto runs = 10;
+
+    // Ids as the game hands them out, with every other entity destroyed again.
+    auto ids = std::vector<net_id>();
+    for (auto id = net_id{1}; id <= count * 2; id += 2) {
+        ids.push_back(id);
+    }
+
+    auto rng = std::mt19937{42};
+    auto pick = std::uniform_int_distribution<std::size_t>(0, ids.size() - 1);
+    auto queries = std::vector<net_id>(lookups);
+    for (auto& q : queries) {
+        q = ids[pick(rng)];
+    }
+
+    std::cout << std::endl << ids.size() << " entities, " << lookups << " lookups" << std::endl;
+
+    auto sink = std::uint64_t{0};
+
+    auto map = std::unordered_map<net_id, std::uint64_t>();
+    bench::report("unordered_map insert", bench::best_of(runs, [&] {
+        map.clear();
+    }, [&] {
+        for (auto id : ids) {
+            map.emplace(id, std::uint64_t(id));
+        }
+    }));
+    bench::report("unordered_map find", bench::best_of(runs, [&] {
+        for (auto id : queries) {
+            sink += map.find(id)->second;
+        }
+    }));
+
+    auto index = std::unique_ptr<paged_index<std::uint64_t>>();
+    bench::report("paged_index insert", bench::best_of(runs, [&] {
+        index = std::make_unique<paged_index<std::uint64_t>>();
+    }, [&] {
+        for (auto id : ids) {
+            index->insert(id, std::uint64_t(id));
+        }
+    }));
+    bench::report("paged_index find", bench::best_of(runs, [&] {
+        for (auto id : queries) {
+            sink += *index->find(id);
+        }
+    }));
+
+    // The full lookup, including the generation check.
+    auto db = ember_database{};
+    for (auto id = net_id{1}; id <= count * 2; ++id) {
+        auto eid = db.create_entity(id);
+        if (id % 2 == 0) {
+            db.destroy_entity(eid);
+        }
+    }
+    bench::report("ember_database::find_entity", bench::best_of(runs, [&] {
+        for (auto id : queries) {
+            sink += db.find_entity(id)->get_index();
+        }
+    }));
+
+    // The lookup before paged_index: a map find, then a check that the entity still has the net_id.
+    auto old_map = std::unordered_map<net_id, ember_database::ent_id>();
+    for (auto id : ids) {
+        old_map.emplace(id, *db.find_entity(id));
+    }
+    auto old_find = [&](net_id id) -> std::optional<ember_database::ent_id> {
+        auto iter = old_map.find(id);
+        if (iter == old_map.end()) {
+            return std::nullopt;
+        }
+        auto eid = iter->second;
+        if (!db.exists(eid) || !db.has_component<component::net_id>(eid) || db.get_component<component::net_id>(eid).id != id) {
+            return std::nullopt;
+        }
+        return eid;
+    };
+    bench::report("unordered_map + net_id check", bench::best_of(runs, [&] {
+        for (auto id : queries) {
+            sink += old_find(id)->get_index();
+        }
+    }));
+
+    std::cout << "(" << sink << ")" << std::endl;
+}
+
+} //namespace
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        run(std::atoi(argv[1]));
+        return 0;
+    }
+
+    for (auto count : {10000, 100000, 1000000}) {
+        run(count);
+    }
+}
@@ -1,12 +1,16 @@
+function load_component(ent, name, data)
+    if component[name] ~= nil then
+        local com = component[name].from_json(data)
+        entities:create_component(ent, com)
+    else
+        print("Unknown component: "..name)
+    end
+end
+
 function load_entity(data)
     local ent = entities:create_entity()
     for k,v in pairs(data) do
-        if component[k] ~= nil then
-            local com = component[k].from_json(v)
-            entities:create_component(ent, com)
-        else
-            print("Unknown component: "..k)
-        end
+        load_component(ent, k, v)
     end
     return ent
 end
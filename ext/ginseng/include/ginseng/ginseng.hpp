@@ -532,11 +532,28 @@ struct database_traits {
 
 // Component Set
 
+/*! Memory statistics of a component set.
+ */
+struct component_set_stats {
+    type_guid guid = 0;
+    std::size_t live = 0;
+    std::size_t slots = 0;
+    std::size_t buckets = 0;
+    std::size_t capacity = 0;
+    std::size_t bucket_bytes = 0;
+    std::size_t entid_to_comid_size = 0;
+    std::size_t comid_to_entid_size = 0;
+    std::size_t index_bytes = 0;
+};
+
 class component_set {
 public:
     using size_type = std::size_t;
     virtual ~component_set() = 0;
     virtual void remove(size_type entid) = 0;
+    virtual component_set_stats get_stats() const = 0;
+    virtual void compact() = 0;
+    virtual bool compact_step(size_type max_work) = 0;
 };
 
 inline component_set::~component_set() = default;
@@ -582,10 +599,34 @@ public:
         new (&slot->component) T(std::move(com));
         entid_to_comid[entid] = index;
         comid_to_entid[index] = entid;
+        ++live;
 
         return index;
     }
 
+    /*! Reserves storage for more components.
+     *
+     * Allocates the buckets needed to assign `n` more components without further allocation,
+     * and grows the entity index to cover `entity_count` entities.
+     */
+    void reserve(size_type n, size_type entity_count) {
+        if (entity_count > entid_to_comid.size()) {
+            entid_to_comid.resize(entity_count);
+        }
+
+        auto free_slots = back_index - live;
+        if (n <= free_slots) {
+            return;
+        }
+
+        auto needed = back_index + (n - free_slots);
+        while (get_total_size(buckets.size()) < needed) {
+            auto bucket_size = get_bucket_size(buckets.size());
+            buckets.push_back(std::make_unique<storage[]>(bucket_size));
+            comid_to_entid.resize(comid_to_entid.size() + bucket_size, -1);
+        }
+    }
+
     virtual void remove(size_type entid) override final {
         auto index = entid_to_comid[entid];
         auto bucket = get_bucket_index(index);
@@ -593,9 +634,141 @@ public:
         auto& slot = buckets[bucket][rel_index];
 
         slot.component.~T();
-        slot.next_free = free_head;
-        free_head = index;
+        if (!compacting) {
+            slot.next_free = free_head;
+            free_head = index;
+        }
         comid_to_entid[index] = -1;
+        --live;
+    }
+
+    virtual component_set_stats get_stats() const override final {
+        component_set_stats stats;
+        stats.guid = get_type_guid<T>();
+        stats.live = live;
+        stats.slots = back_index;
+        stats.buckets = buckets.size();
+        stats.capacity = get_total_size(buckets.size());
+        stats.bucket_bytes = stats.capacity * sizeof(storage);
+        stats.entid_to_comid_size = entid_to_comid.size();
+        stats.comid_to_entid_size = comid_to_entid.size();
+        stats.index_bytes = (entid_to_comid.capacity() + comid_to_entid.capacity()) * sizeof(size_type);
+        return stats;
+    }
+
+    /*! Compacts the set.
+     *
+     * Moves the live components to the front of the storage, sorted by entity, and frees the
+     * buckets that are no longer needed. Invalidates all ComIDs of this set.
+     */
+    virtual void compact() override final {
+        std::vector<size_type> order;
+        order.reserve(live);
+        for (size_type comid = 0; comid < back_index; ++comid) {
+            if (is_valid(comid)) {
+                order.push_back(comid);
+            }
+        }
+
+        std::sort(begin(order), end(order), [&](size_type a, size_type b) {
+            return comid_to_entid[a] < comid_to_entid[b];
+        });
+
+        std::vector<std::unique_ptr<storage[]>> new_buckets;
+        std::vector<size_type> new_comid_to_entid;
+
+        for (size_type comid = 0; comid < order.size(); ++comid) {
+            auto bucket = get_bucket_index(comid);
+            if (bucket == new_buckets.size()) {
+                auto bucket_size = get_bucket_size(bucket);
+                new_buckets.push_back(std::make_unique<storage[]>(bucket_size));
+                new_comid_to_entid.resize(new_comid_to_entid.size() + bucket_size, -1);
+            }
+
+            auto old_comid = order[comid];
+            auto& src = buckets[get_bucket_index(old_comid)][get_relative_index(get_bucket_index(old_comid), old_comid)];
+            auto& dst = new_buckets[bucket][get_relative_index(bucket, comid)];
+            new (&dst.component) T(std::move(src.component));
+            src.component.~T();
+
+            auto entid = comid_to_entid[old_comid];
+            new_comid_to_entid[comid] = entid;
+            entid_to_comid[entid] = comid;
+        }
+
+        buckets = std::move(new_buckets);
+        comid_to_entid = std::move(new_comid_to_entid);
+        back_index = order.size();
+        free_head = back_index;
+        compacting = false;
+    }
+
+    /*! Does a bounded part of an incremental compaction.
+     *
+     * Fills the lowest free slots with the components at the back of the storage, looking at no
+     * more than `max_work` slots per call. While a pass is in progress, new components are
+     * appended and freed slots are left for the pass to fill. Unlike `compact`, components are not
+     * put in entity order. Invalidates the ComIDs of the moved components.
+     *
+     * @return True if the pass is finished and the set is dense.
+     */
+    virtual bool compact_step(size_type max_work) override final {
+        if (!compacting) {
+            compacting = true;
+            compact_low = 0;
+        }
+
+        auto work = size_type{0};
+
+        auto trim = [&] {
+            while (back_index > 0 && !is_valid(back_index - 1) && work < max_work) {
+                --back_index;
+                ++work;
+            }
+            free_head = back_index;
+        };
+
+        trim();
+
+        while (compact_low < back_index && work < max_work) {
+            ++work;
+            if (is_valid(compact_low)) {
+                ++compact_low;
+                continue;
+            }
+
+            auto old_comid = back_index - 1;
+            if (!is_valid(old_comid)) {
+                trim();
+                continue;
+            }
+
+            auto& src = get_slot(old_comid);
+            auto& dst = get_slot(compact_low);
+            new (&dst.component) T(std::move(src.component));
+            src.component.~T();
+
+            auto entid = comid_to_entid[old_comid];
+            comid_to_entid[compact_low] = entid;
+            comid_to_entid[old_comid] = -1;
+            entid_to_comid[entid] = compact_low;
+
+            ++compact_low;
+            --back_index;
+            trim();
+        }
+
+        if (compact_low < back_index) {
+            return false;
+        }
+
+        auto num_buckets = get_bucket_index(back_index + bucket_size - 1);
+        buckets.resize(num_buckets);
+        comid_to_entid.resize(get_total_size(num_buckets));
+        free_head = back_index;
+        compacting = false;
+
+        return true;
     }
 
     bool is_valid(size_type comid) const {
@@ -622,10 +795,7 @@ public:
     }
 
     auto count() const {
-        return std::count_if(
-            begin(comid_to_entid),
-            begin(comid_to_entid) + size(),
-            [&](const auto& x){ return is_valid(x); });
+        return live;
     }
 
 private:
@@ -642,9 +812,17 @@ private:
     std::vector<std::unique_ptr<storage[]>> buckets;
     size_type free_head = 0;
     size_type back_index = 0;
+    size_type live = 0;
+    bool compacting = false;
+    size_type compact_low = 0;
 
     static constexpr size_type bucket_size = 4096 * 8;
 
+    storage& get_slot(size_type comid) {
+        auto bucket = get_bucket_index(comid);
+        return buckets[bucket][get_relative_index(bucket, comid)];
+    }
+
     static size_type get_bucket_index(size_type idx) {
         return idx / bucket_size;
     }
@@ -666,7 +844,17 @@ template <typename T>
 class component_set_impl<tag<T>> final : public component_set {
 public:
     virtual ~component_set_impl() = default;
+    void reserve(size_type n, size_type entity_count) {}
     virtual void remove(size_type entid) override final {}
+    virtual component_set_stats get_stats() const override final {
+        component_set_stats stats;
+        stats.guid = get_type_guid<tag<T>>();
+        return stats;
+    }
+    virtual void compact() override final {}
+    virtual bool compact_step(size_type max_work) override final {
+        return true;
+    }
 };
 
 // Opaque index
@@ -745,6 +933,32 @@ public:
         return eid;
     }
 
+    /*! Reserves space for new Entities.
+     *
+     * Grows the entity table so that `n` more Entities can be created without reallocating it.
+     *
+     * @param n Number of Entities that will be created.
+     */
+    void reserve_entities(std::size_t n) {
+        auto needed = entities.size() + n - std::min(n, free_entities.size());
+        if (needed > entities.capacity()) {
+            entities.reserve(std::max(needed, entities.capacity() * 2));
+        }
+    }
+
+    /*! Reserves space for new components.
+     *
+     * Allocates storage for `n` more components of type `Com`, so that creating them does not
+     * grow the component set one bucket at a time.
+     *
+     * @tparam Com Component type.
+     * @param n Number of components that will be created.
+     */
+    template <typename Com>
+    void reserve_components(std::size_t n) {
+        get_or_create_com_set<Com>().reserve(n, entities.capacity());
+    }
+
     /*! Destroys an Entity.
      *
      * Destroys the given Entity and all associated components.
@@ -927,7 +1141,133 @@ public:
         using traits = typename db_traits::visitor_traits<Visitor>;
         using primary_component = typename traits::primary_component;
 
-        return visit_helper(std::forward<Visitor>(visitor), primary_component{});
+        return visit_helper(std::forward<Visitor>(visitor), primary_component{}, 0, std::size_t(-1));
+    }
+
+    /*! Get the extent of a visit.
+     *
+     * Returns the number of slots a visit with the given visitor type iterates over: the slots of
+     * its primary component's set, or all entity slots if it has no primary component.
+     * Slots are not all occupied, so this is an upper bound on the number of entities visited.
+     */
+    template <typename Visitor>
+    std::size_t visit_extent() {
+        using db_traits = database_traits<database>;
+        using traits = typename db_traits::visitor_traits<Visitor>;
+        using primary_component = typename traits::primary_component;
+
+        return visit_extent_helper(primary_component{});
+    }
+
+    /*! Visit a range of the Database.
+     *
+     * Like `visit`, but only visits the slots in [first, last), see `visit_extent`.
+     * Visits of disjoint ranges touch disjoint primary components and entities.
+     */
+    template <typename Visitor>
+    void visit_range(Visitor&& visitor, std::size_t first, std::size_t last) {
+        using db_traits = database_traits<database>;
+        using traits = typename db_traits::visitor_traits<Visitor>;
+        using primary_component = typename traits::primary_component;
+
+        return visit_helper(std::forward<Visitor>(visitor), primary_component{}, first, last);
+    }
+
+    /*! Checks if an entity exists.
+     *
+     * @param eid ID of the entity.
+     * @return True if the entity has been created and not destroyed.
+     */
+    bool exists(ent_id eid) const {
+        return eid < entities.size() && entities[eid].components.get(0);
+    }
+
+    /*! Memory statistics of the Database.
+     */
+    struct stats {
+        std::size_t entities = 0;
+        std::size_t free_entities = 0;
+        std::size_t entity_bytes = 0;
+        std::vector<component_set_stats> component_sets;
+    };
+
+    /*! Get memory statistics.
+     *
+     * Covers the entity table, the free list, and every component set that has been created.
+     *
+     * @return Statistics of the Database.
+     */
+    stats get_stats() const {
+        stats rv;
+        rv.entities = entities.size();
+        rv.free_entities = free_entities.size();
+        rv.entity_bytes = entities.capacity() * sizeof(entity) + free_entities.capacity() * sizeof(ent_id);
+        for (const auto& com_set : component_sets) {
+            if (com_set) {
+                rv.component_sets.push_back(com_set->get_stats());
+            }
+        }
+        return rv;
+    }
+
+    /*! Compacts the Database.
+     *
+     * Compacts every component set, see `compact_step`, and orders the entity free list so that
+     * the lowest free IDs are reused first.
+     *
+     * @warning
+     * All ComIDs will be invalidated.
+     */
+    void compact() {
+        for (auto& com_set : component_sets) {
+            if (com_set) {
+                com_set->compact();
+            }
+        }
+        compact_in_progress = false;
+        sort_free_entities();
+    }
+
+    /*! Does a bounded part of compacting one component set.
+     *
+     * Continues the compaction in progress, or starts one on the next component set, in
+     * round-robin order, whose share of free slots is above `max_free_ratio`. Each call looks at
+     * no more than `max_work` slots, moving live components from the back of the set into free
+     * slots near the front, so visits skip fewer holes after heavy churn. See `compact` for a
+     * full compaction that also restores entity order.
+     *
+     * @warning
+     * ComIDs of moved components will be invalidated.
+     *
+     * @param max_free_ratio Share of free slots a set may have before it is compacted.
+     * @param max_work Number of slots a call may look at.
+     * @return True if a set is being compacted.
+     */
+    bool compact_step(double max_free_ratio = 0.25, std::size_t max_work = 4096) {
+        if (!compact_in_progress) {
+            for (std::size_t i = 0; i < component_sets.size() && !compact_in_progress; ++i) {
+                auto guid = (compact_cursor + i) % component_sets.size();
+                auto& com_set = component_sets[guid];
+                if (!com_set) {
+                    continue;
+                }
+                auto stats = com_set->get_stats();
+                if (stats.slots > stats.live && double(stats.slots - stats.live) > double(stats.slots) * max_free_ratio) {
+                    compact_cursor = guid;
+                    compact_in_progress = true;
+                }
+            }
+            if (!compact_in_progress) {
+                return false;
+            }
+        }
+
+        if (component_sets[compact_cursor]->compact_step(max_work)) {
+            compact_in_progress = false;
+            ++compact_cursor;
+        }
+
+        return true;
     }
 
     /*! Get the number of entities in the Database.
@@ -946,6 +1286,12 @@ public:
 private:
     friend class database_traits<database>;
 
+    void sort_free_entities() {
+        std::sort(begin(free_entities), end(free_entities), [](ent_id a, ent_id b) {
+            return a.get_index() > b.get_index();
+        });
+    }
+
     template <typename Com>
     Com& get_component(ent_id eid, type_guid guid) {
         auto& com_set = *unsafe_get_com_set<Com>(guid);
@@ -999,8 +1345,20 @@ private:
         return *com_set_impl;
     }
 
+    template <typename Component>
+    std::size_t visit_extent_helper(primary<Component>) {
+        if (auto com_set_ptr = get_com_set<Component>()) {
+            return com_set_ptr->size();
+        }
+        return 0;
+    }
+
+    std::size_t visit_extent_helper(primary<void>) {
+        return entities.size();
+    }
+
     template <typename Visitor, typename Component>
-    void visit_helper(Visitor&& visitor, primary<Component>) {
+    void visit_helper(Visitor&& visitor, primary<Component>, std::size_t first, std::size_t last) {
         using db_traits = database_traits<database>;
         using visitor_traits = typename db_traits::visitor_traits<Visitor>;
 
@@ -1009,7 +1367,7 @@ private:
         if (auto com_set_ptr = get_com_set<Component>(traits.template get_guid<Component>())) {
             auto& com_set = *com_set_ptr;
 
-            for (com_id cid = 0, sz = com_set.size(); cid < sz; ++cid) {
+            for (com_id cid = first, sz = std::min<std::size_t>(com_set.size(), last); cid < sz; ++cid) {
                 if (com_set.is_valid(cid)) {
                     auto eid = com_set.get_entid(cid);
                     traits.apply(*this, eid, cid, visitor);
@@ -1019,13 +1377,13 @@ private:
     }
 
     template <typename Visitor>
-    void visit_helper(Visitor&& visitor, primary<void>) {
+    void visit_helper(Visitor&& visitor, primary<void>, std::size_t first, std::size_t last) {
         using db_traits = database_traits<database>;
         using visitor_traits = typename db_traits::visitor_traits<Visitor>;
 
         auto traits = visitor_traits{};
 
-        for (auto eid = 0; eid < entities.size(); ++eid) {
+        for (auto eid = first, sz = std::min<std::size_t>(entities.size(), last); eid < sz; ++eid) {
             if (entities[eid].components.get(0)) {
                 traits.apply(*this, eid, {}, visitor);
             }
@@ -1035,6 +1393,8 @@ private:
     std::vector<entity> entities;
     std::vector<ent_id> free_entities;
     std::vector<std::unique_ptr<component_set>> component_sets;
+    std::size_t compact_cursor = 0;
+    bool compact_in_progress = false;
 };
 
 } // namespace _detail
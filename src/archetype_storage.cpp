@@ -0,0 +1,210 @@
+#include "archetype_storage.hpp"
+
+#include <cassert>
+
+namespace archetypes {
+
+chunk::chunk(std::size_t bytes, std::size_t align, const std::vector<std::size_t>& offsets) :
+    memory(static_cast<std::byte*>(::operator new(std::max(bytes, std::size_t{1}), std::align_val_t(align)))),
+    align(align)
+{
+    columns.reserve(offsets.size());
+    for (auto offset : offsets) {
+        columns.push_back(memory + offset);
+    }
+}
+
+chunk::~chunk() {
+    ::operator delete(memory, std::align_val_t(align));
+}
+
+archetype::archetype(std::vector<const column_type*> types) :
+    types(std::move(types))
+{
+    // One array of `capacity` elements per column, each aligned for its type.
+    for (auto type : this->types) {
+        if (type->size == 0) {
+            offsets.push_back(0);
+            continue;
+        }
+
+        chunk_bytes = (chunk_bytes + type->align - 1) / type->align * type->align;
+        offsets.push_back(chunk_bytes);
+        chunk_bytes += type->size * chunk::capacity;
+        chunk_align = std::max(chunk_align, type->align);
+    }
+}
+
+archetype::~archetype() {
+    for (auto& c : chunks) {
+        for (auto row = std::size_t{0}; row < c->size; ++row) {
+            for (auto i = std::size_t{0}; i < types.size(); ++i) {
+                if (types[i]->size != 0) {
+                    types[i]->destroy(c->get_column(i) + row * types[i]->size);
+                }
+            }
+        }
+    }
+}
+
+auto archetype::allocate(ent_id eid) -> row_ref {
+    if (chunks.empty() || chunks.back()->size == chunk::capacity) {
+        chunks.push_back(std::make_unique<chunk>(chunk_bytes, chunk_align, offsets));
+    }
+
+    auto& c = *chunks.back();
+    auto row = c.size++;
+    c.entities[row] = eid;
+    ++count;
+
+    return {std::uint32_t(chunks.size() - 1), std::uint32_t(row)};
+}
+
+bool archetype::remove(row_ref ref, ent_id& moved) {
+    for (auto i = std::size_t{0}; i < types.size(); ++i) {
+        if (types[i]->size != 0) {
+            types[i]->destroy(get(int(i), ref));
+        }
+    }
+
+    return fill_hole(ref, moved);
+}
+
+bool archetype::fill_hole(row_ref ref, ent_id& moved) {
+    auto& last_chunk = *chunks.back();
+    auto last = row_ref{std::uint32_t(chunks.size() - 1), std::uint32_t(last_chunk.size - 1)};
+    auto filled = false;
+
+    if (last.chunk != ref.chunk || last.row != ref.row) {
+        for (auto i = std::size_t{0}; i < types.size(); ++i) {
+            if (types[i]->size != 0) {
+                types[i]->move_construct(get(int(i), ref), get(int(i), last));
+                types[i]->destroy(get(int(i), last));
+            }
+        }
+
+        moved = last_chunk.entities[last.row];
+        chunks[ref.chunk]->entities[ref.row] = moved;
+        filled = true;
+    }
+
+    --last_chunk.size;
+    --count;
+
+    if (last_chunk.size == 0) {
+        chunks.pop_back();
+    }
+
+    return filled;
+}
+
+void archetype_store::erase(ent_id eid) {
+    auto& loc = locations[eid.get_index()];
+
+    ent_id moved;
+    if (loc.arch->remove(loc.ref, moved)) {
+        locations[moved.get_index()].ref = loc.ref;
+    }
+
+    loc = {};
+    --count;
+}
+
+auto archetype_store::get_memory_stats() const -> memory_stats {
+    memory_stats stats;
+
+    for (auto arch : archetype_list) {
+        ++stats.archetypes;
+        stats.chunks += arch->chunks.size();
+        stats.rows += arch->size();
+        stats.capacity += arch->chunks.size() * chunk::capacity;
+        stats.bytes += sizeof(archetype) + arch->chunks.size() * arch->get_chunk_bytes();
+    }
+
+    stats.bytes += locations.capacity() * sizeof(location);
+
+    return stats;
+}
+
+archetype& archetype_store::get_archetype(std::vector<const column_type*> types) {
+    std::vector<type_guid> signature;
+    signature.reserve(types.size());
+    for (auto type : types) {
+        signature.push_back(type->guid);
+    }
+
+    assert(std::adjacent_find(begin(signature), end(signature)) == end(signature));
+
+    auto& arch = archetypes[signature];
+
+    if (!arch) {
+        arch = std::make_unique<archetype>(std::move(types));
+        archetype_list.push_back(arch.get());
+    }
+
+    return *arch;
+}
+
+archetype& archetype_store::with(archetype& from, const column_type& type) {
+    auto& edge = from.add_edges[type.guid];
+
+    if (!edge) {
+        auto types = from.get_types();
+        types.insert(std::upper_bound(begin(types), end(types), &type, [](const column_type* a, const column_type* b) {
+            return a->guid < b->guid;
+        }), &type);
+        edge = &get_archetype(std::move(types));
+    }
+
+    return *edge;
+}
+
+archetype& archetype_store::without(archetype& from, type_guid guid) {
+    auto& edge = from.remove_edges[guid];
+
+    if (!edge) {
+        auto types = from.get_types();
+        types.erase(std::remove_if(begin(types), end(types), [&](const column_type* t) {
+            return t->guid == guid;
+        }), end(types));
+        edge = &get_archetype(std::move(types));
+    }
+
+    return *edge;
+}
+
+archetype::row_ref archetype_store::move_entity(ent_id eid, archetype& to) {
+    auto& loc = locations[eid.get_index()];
+    auto& from = *loc.arch;
+    auto ref = to.allocate(eid);
+
+    const auto& from_types = from.get_types();
+    for (auto i = std::size_t{0}; i < from_types.size(); ++i) {
+        if (from_types[i]->size == 0) {
+            continue;
+        }
+        auto column = to.find_column(from_types[i]->guid);
+        if (column >= 0) {
+            from_types[i]->move_construct(to.get(column, ref), from.get(int(i), loc.ref));
+        }
+    }
+
+    // Moved-from values still need their destructors run.
+    ent_id moved;
+    if (from.remove(loc.ref, moved)) {
+        locations[moved.get_index()].ref = loc.ref;
+    }
+
+    loc = {&to, ref};
+
+    return ref;
+}
+
+void archetype_store::set_location(ent_id eid, location loc) {
+    if (eid.get_index() >= locations.size()) {
+        locations.resize(eid.get_index() + 1);
+    }
+    locations[eid.get_index()] = loc;
+}
+
+} //namespace archetypes
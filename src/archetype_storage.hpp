@@ -0,0 +1,461 @@
+#ifndef LD42_ARCHETYPE_STORAGE_HPP
+#define LD42_ARCHETYPE_STORAGE_HPP
+
+#include "utility.hpp"
+#include "job_system.hpp"
+
+#include <ginseng/ginseng.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace archetypes {
+
+using type_guid = ginseng::_detail::type_guid;
+using ent_id = ginseng::database::ent_id;
+
+// How to move and destroy values of a component type stored in raw chunk memory.
+struct column_type {
+    type_guid guid;
+    std::size_t size;  // 0 for empty types such as tags, which are only recorded in the signature.
+    std::size_t align;
+    void (*move_construct)(void* dst, void* src);
+    void (*destroy)(void* ptr);
+};
+
+template <typename T>
+const column_type& get_column_type() {
+    static const column_type type = {
+        ginseng::_detail::get_type_guid<T>(),
+        std::is_empty_v<T> ? 0 : sizeof(T),
+        alignof(T),
+        [](void* dst, void* src) { new (dst) T(std::move(*static_cast<T*>(src))); },
+        [](void* ptr) { static_cast<T*>(ptr)->~T(); },
+    };
+    return type;
+}
+
+// A fixed number of rows, with one array per component column and one for the entity ids.
+class chunk {
+public:
+    static constexpr std::size_t capacity = 256;
+
+    chunk(std::size_t bytes, std::size_t align, const std::vector<std::size_t>& offsets);
+    chunk(const chunk&) = delete;
+    chunk& operator=(const chunk&) = delete;
+    ~chunk();
+
+    std::byte* get_column(std::size_t column) const {
+        return columns[column];
+    }
+
+    std::size_t size = 0;
+    std::array<ent_id, capacity> entities;
+
+private:
+    std::byte* memory;
+    std::size_t align;
+    std::vector<std::byte*> columns;
+};
+
+// All entities with exactly the same set of component types.
+class archetype {
+public:
+    struct row_ref {
+        std::uint32_t chunk;
+        std::uint32_t row;
+    };
+
+    // Types must be sorted by guid.
+    explicit archetype(std::vector<const column_type*> types);
+    archetype(const archetype&) = delete;
+    archetype& operator=(const archetype&) = delete;
+    ~archetype();
+
+    const std::vector<const column_type*>& get_types() const {
+        return types;
+    }
+
+    // Index of the column with the given guid, or -1.
+    int find_column(type_guid guid) const {
+        auto iter = std::lower_bound(begin(types), end(types), guid, [](const column_type* t, type_guid g) {
+            return t->guid < g;
+        });
+        return iter != end(types) && (*iter)->guid == guid ? int(iter - begin(types)) : -1;
+    }
+
+    void* get(int column, row_ref ref) const {
+        return chunks[ref.chunk]->get_column(column) + ref.row * types[column]->size;
+    }
+
+    // Adds a row with uninitialized components.
+    row_ref allocate(ent_id eid);
+
+    // Destroys a row's components and fills the hole with the last row.
+    // Returns true and sets `moved` if another entity was moved into the hole.
+    bool remove(row_ref ref, ent_id& moved);
+
+    std::size_t size() const {
+        return count;
+    }
+
+    // Bytes of one chunk, ids included.
+    std::size_t get_chunk_bytes() const {
+        return chunk_bytes + sizeof(chunk);
+    }
+
+    std::vector<std::unique_ptr<chunk>> chunks;
+    std::unordered_map<type_guid, archetype*> add_edges;
+    std::unordered_map<type_guid, archetype*> remove_edges;
+
+private:
+    bool fill_hole(row_ref ref, ent_id& moved);
+
+    std::vector<const column_type*> types;
+    std::vector<std::size_t> offsets;
+    std::size_t chunk_bytes = 0;
+    std::size_t chunk_align = alignof(std::max_align_t);
+    std::size_t count = 0;
+};
+
+namespace _detail {
+
+template <typename T>
+using category_t = typename ginseng::_detail::component_traits<ginseng::database, T>::category;
+
+template <typename T>
+using component_t = typename ginseng::_detail::component_traits<ginseng::database, T>::component;
+
+template <typename T>
+struct is_tag : std::false_type {};
+
+template <typename T>
+struct is_tag<ginseng::tag<T>> : std::true_type {};
+
+template <typename T>
+struct visitor_params : visitor_params<decltype(&std::decay_t<T>::operator())> {};
+
+template <typename R, typename... Ts>
+struct visitor_params<R (&)(Ts...)> {
+    using type = utility::type_list<Ts...>;
+};
+
+template <typename V, typename R, typename... Ts>
+struct visitor_params<R (V::*)(Ts...)> {
+    using type = utility::type_list<Ts...>;
+};
+
+template <typename V, typename R, typename... Ts>
+struct visitor_params<R (V::*)(Ts...) const> {
+    using type = utility::type_list<Ts...>;
+};
+
+template <typename T>
+using visitor_params_t = typename visitor_params<T>::type;
+
+// Per-chunk column pointer for a visitor parameter, resolved once per chunk.
+template <typename P, typename Category = category_t<P>>
+struct param {
+    // Normal components.
+    using base_type = P*;
+
+    static bool matches(const archetype& arch) {
+        return arch.find_column(ginseng::_detail::get_type_guid<P>()) >= 0;
+    }
+
+    static base_type get_base(const archetype& arch, const chunk& c) {
+        return reinterpret_cast<P*>(c.get_column(arch.find_column(ginseng::_detail::get_type_guid<P>())));
+    }
+
+    static P& get(base_type base, const chunk& c, std::size_t row) {
+        return base[row];
+    }
+};
+
+template <typename P>
+struct param<P, ginseng::_detail::component_tags::noload> {
+    // require<T>
+    using base_type = std::nullptr_t;
+
+    static bool matches(const archetype& arch) {
+        return arch.find_column(ginseng::_detail::get_type_guid<component_t<P>>()) >= 0;
+    }
+
+    static base_type get_base(const archetype& arch, const chunk& c) {
+        return nullptr;
+    }
+
+    static P get(base_type, const chunk&, std::size_t) {
+        return {};
+    }
+};
+
+template <typename P>
+struct param<P, ginseng::_detail::component_tags::tagged> : param<P, ginseng::_detail::component_tags::noload> {};
+
+template <typename P>
+struct param<P, ginseng::_detail::component_tags::inverted> : param<P, ginseng::_detail::component_tags::noload> {
+    // deny<T>
+    static bool matches(const archetype& arch) {
+        return arch.find_column(ginseng::_detail::get_type_guid<component_t<P>>()) < 0;
+    }
+};
+
+template <typename P>
+struct param<P, ginseng::_detail::component_tags::eid> {
+    using base_type = const ent_id*;
+
+    static bool matches(const archetype& arch) {
+        return true;
+    }
+
+    static base_type get_base(const archetype& arch, const chunk& c) {
+        return c.entities.data();
+    }
+
+    static const ent_id& get(base_type base, const chunk& c, std::size_t row) {
+        return base[row];
+    }
+};
+
+template <typename P>
+struct param<P, ginseng::_detail::component_tags::optional> {
+    using inner_type = component_t<P>;
+
+    // Tags are a flag, components a possibly null column.
+    using base_type = std::conditional_t<is_tag<inner_type>::value, bool, inner_type*>;
+
+    static bool matches(const archetype& arch) {
+        return true;
+    }
+
+    static base_type get_base(const archetype& arch, const chunk& c) {
+        auto column = arch.find_column(ginseng::_detail::get_type_guid<inner_type>());
+        if constexpr (is_tag<inner_type>::value) {
+            return column >= 0;
+        } else {
+            return column >= 0 ? reinterpret_cast<inner_type*>(c.get_column(column)) : nullptr;
+        }
+    }
+
+    static P get(base_type base, const chunk& c, std::size_t row) {
+        if constexpr (is_tag<inner_type>::value) {
+            return P(base);
+        } else {
+            return base ? P(base[row]) : P();
+        }
+    }
+};
+
+} //namespace _detail
+
+// Archetype storage
+//
+// Stores entities grouped by their exact set of component types, in chunks with one contiguous
+// array per component type. Visiting streams through the arrays of every matching archetype
+// instead of checking each entity.
+//
+// Adding or removing a component moves the entity to another archetype, so like ginseng, the
+// set of entities must not be changed while visiting.
+class archetype_store {
+public:
+    archetype_store() = default;
+    archetype_store(const archetype_store&) = delete;
+    archetype_store& operator=(const archetype_store&) = delete;
+    archetype_store(archetype_store&&) = default;
+    archetype_store& operator=(archetype_store&&) = default;
+
+    bool contains(ent_id eid) const {
+        return eid.get_index() < locations.size() && locations[eid.get_index()].arch;
+    }
+
+    std::size_t size() const {
+        return count;
+    }
+
+    template <typename... Coms>
+    void insert(ent_id eid, Coms&&... coms) {
+        insert_into(get_archetype_of<std::decay_t<Coms>...>(), eid, std::forward<Coms>(coms)...);
+    }
+
+    // The archetype of entities with exactly these components, for inserting many of them.
+    template <typename... Coms>
+    archetype& get_archetype_of() {
+        std::vector<const column_type*> types = {&get_column_type<Coms>()...};
+        std::sort(begin(types), end(types), [](const column_type* a, const column_type* b) {
+            return a->guid < b->guid;
+        });
+
+        return get_archetype(std::move(types));
+    }
+
+    template <typename... Coms>
+    void insert_into(archetype& arch, ent_id eid, Coms&&... coms) {
+        auto ref = arch.allocate(eid);
+
+        (construct(arch, ref, std::forward<Coms>(coms)), ...);
+
+        set_location(eid, {&arch, ref});
+        ++count;
+    }
+
+    void erase(ent_id eid);
+
+    struct memory_stats {
+        std::size_t archetypes = 0;
+        std::size_t chunks = 0;
+        std::size_t rows = 0;
+        std::size_t capacity = 0;
+        std::size_t bytes = 0;
+    };
+
+    memory_stats get_memory_stats() const;
+
+    template <typename Com>
+    Com* find(ent_id eid) {
+        auto& loc = locations[eid.get_index()];
+        auto column = loc.arch->find_column(ginseng::_detail::get_type_guid<Com>());
+        return column >= 0 ? static_cast<Com*>(loc.arch->get(column, loc.ref)) : nullptr;
+    }
+
+    template <typename Com>
+    bool has(ent_id eid) const {
+        return locations[eid.get_index()].arch->find_column(ginseng::_detail::get_type_guid<Com>()) >= 0;
+    }
+
+    // Overwrites the component, or moves the entity to an archetype that has it.
+    template <typename Com>
+    void assign(ent_id eid, Com&& com) {
+        using type = std::decay_t<Com>;
+
+        if (auto existing = find<type>(eid)) {
+            if constexpr (!std::is_empty_v<type>) {
+                *existing = std::forward<Com>(com);
+            }
+            return;
+        }
+
+        auto& loc = locations[eid.get_index()];
+        auto& to = with(*loc.arch, get_column_type<type>());
+        auto ref = move_entity(eid, to);
+
+        construct(to, ref, std::forward<Com>(com));
+    }
+
+    template <typename Com>
+    void remove(ent_id eid) {
+        auto& loc = locations[eid.get_index()];
+        auto guid = ginseng::_detail::get_type_guid<Com>();
+
+        if (loc.arch->find_column(guid) < 0) {
+            return;
+        }
+
+        move_entity(eid, without(*loc.arch, guid));
+    }
+
+    template <typename Visitor>
+    void visit(Visitor&& visitor) {
+        visit_impl(visitor, _detail::visitor_params_t<Visitor>{});
+    }
+
+    // Visits the matching chunks on the pool, about `grain` entities per task.
+    template <typename Visitor>
+    void parallel_visit(job_system& jobs, Visitor&& visitor, std::size_t grain) {
+        parallel_visit_impl(jobs, visitor, grain, _detail::visitor_params_t<Visitor>{});
+    }
+
+private:
+    struct location {
+        archetype* arch = nullptr;
+        archetype::row_ref ref = {0, 0};
+    };
+
+    template <typename Com>
+    static void construct(archetype& arch, archetype::row_ref ref, Com&& com) {
+        using type = std::decay_t<Com>;
+        if constexpr (!std::is_empty_v<type>) {
+            auto column = arch.find_column(ginseng::_detail::get_type_guid<type>());
+            new (arch.get(column, ref)) type(std::forward<Com>(com));
+        }
+    }
+
+    template <typename Visitor, typename... Ps>
+    void visit_impl(Visitor& visitor, utility::type_list<Ps...>) {
+        visit_params<std::decay_t<Ps>...>(visitor, std::index_sequence_for<Ps...>{});
+    }
+
+    template <typename... Ps, typename Visitor, std::size_t... Is>
+    void visit_params(Visitor& visitor, std::index_sequence<Is...>) {
+        // Archetypes created during the visit are not visited.
+        for (auto a = std::size_t{0}, num_archetypes = archetype_list.size(); a < num_archetypes; ++a) {
+            auto& arch = *archetype_list[a];
+
+            if (arch.size() == 0 || !(_detail::param<Ps>::matches(arch) && ...)) {
+                continue;
+            }
+
+            for (auto& c : arch.chunks) {
+                visit_chunk<Ps...>(visitor, arch, *c, std::index_sequence<Is...>{});
+            }
+        }
+    }
+
+    template <typename Visitor, typename... Ps>
+    void parallel_visit_impl(job_system& jobs, Visitor& visitor, std::size_t grain, utility::type_list<Ps...>) {
+        using index_sequence = std::index_sequence_for<Ps...>;
+
+        std::vector<std::pair<archetype*, chunk*>> chunks;
+
+        for (auto arch : archetype_list) {
+            if (arch->size() == 0 || !(_detail::param<std::decay_t<Ps>>::matches(*arch) && ...)) {
+                continue;
+            }
+            for (auto& c : arch->chunks) {
+                chunks.emplace_back(arch, c.get());
+            }
+        }
+
+        jobs.parallel_for(0, chunks.size(), std::max(grain / chunk::capacity, std::size_t{1}), [&](std::size_t first, std::size_t last) {
+            for (auto i = first; i < last; ++i) {
+                visit_chunk<std::decay_t<Ps>...>(visitor, *chunks[i].first, *chunks[i].second, index_sequence{});
+            }
+        });
+    }
+
+    template <typename... Ps, typename Visitor, std::size_t... Is>
+    static void visit_chunk(Visitor& visitor, const archetype& arch, const chunk& c, std::index_sequence<Is...>) {
+        auto bases = std::make_tuple(_detail::param<Ps>::get_base(arch, c)...);
+        for (auto row = std::size_t{0}, sz = c.size; row < sz; ++row) {
+            visitor(_detail::param<Ps>::get(std::get<Is>(bases), c, row)...);
+        }
+    }
+
+    archetype& get_archetype(std::vector<const column_type*> types);
+    archetype& with(archetype& from, const column_type& type);
+    archetype& without(archetype& from, type_guid guid);
+
+    // Moves the components the two archetypes share, the rest of the new row is left uninitialized.
+    archetype::row_ref move_entity(ent_id eid, archetype& to);
+
+    void set_location(ent_id eid, location loc);
+
+    std::map<std::vector<type_guid>, std::unique_ptr<archetype>> archetypes;
+    std::vector<archetype*> archetype_list;
+    std::vector<location> locations;
+    std::size_t count = 0;
+};
+
+} //namespace archetypes
+
+#endif //LD42_ARCHETYPE_STORAGE_HPP
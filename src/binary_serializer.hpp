@@ -0,0 +1,525 @@
+#ifndef LD42_BINARY_SERIALIZER_HPP
+#define LD42_BINARY_SERIALIZER_HPP
+
+#include "components.hpp"
+#include "entities.hpp"
+#include "utility.hpp"
+
+#include <glm/glm.hpp>
+
+#include <Meta.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Compact binary encoding of components and worlds, generated from the Meta registrations.
+//
+// Integers are written as little-endian varints (zigzag for signed types), floats as their
+// little-endian bit patterns, so files are portable between platforms. A world file lists the
+// component types it contains along with a fingerprint of their members, and every component
+// is length-prefixed, so components whose layout changed since the file was written are skipped
+// with a warning instead of misread.
+namespace binary {
+
+constexpr std::uint32_t format_version = 2;
+constexpr std::array<char, 4> world_magic = {'E', 'M', 'B', 'W'};
+
+class writer {
+public:
+    explicit writer(std::vector<std::byte>& out) : out(out) {}
+
+    void write_byte(std::uint8_t byte) {
+        out.push_back(std::byte(byte));
+    }
+
+    void write_varint(std::uint64_t value) {
+        while (value >= 0x80) {
+            write_byte(std::uint8_t(value | 0x80));
+            value >>= 7;
+        }
+        write_byte(std::uint8_t(value));
+    }
+
+    void write_fixed32(std::uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            write_byte(std::uint8_t(value >> (8 * i)));
+        }
+    }
+
+    void write_fixed64(std::uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            write_byte(std::uint8_t(value >> (8 * i)));
+        }
+    }
+
+    void write_bytes(const void* bytes, std::size_t size) {
+        auto begin = static_cast<const std::byte*>(bytes);
+        out.insert(out.end(), begin, begin + size);
+    }
+
+    // Space for a fixed32 to be filled in later, returns its offset.
+    std::size_t reserve_fixed32() {
+        auto offset = out.size();
+        out.resize(offset + 4);
+        return offset;
+    }
+
+    void patch_fixed32(std::size_t offset, std::uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out[offset + i] = std::byte(std::uint8_t(value >> (8 * i)));
+        }
+    }
+
+    std::size_t size() const {
+        return out.size();
+    }
+
+private:
+    std::vector<std::byte>& out;
+};
+
+class reader {
+public:
+    reader(const std::byte* data, std::size_t size) : data(data), end(size) {}
+
+    explicit reader(const std::vector<std::byte>& bytes) : reader(bytes.data(), bytes.size()) {}
+
+    std::uint8_t read_byte() {
+        check(1);
+        return std::uint8_t(data[cursor++]);
+    }
+
+    std::uint64_t read_varint() {
+        auto value = std::uint64_t{0};
+        for (int shift = 0; shift < 64; shift += 7) {
+            auto byte = read_byte();
+            value |= std::uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Malformed varint.");
+    }
+
+    std::uint32_t read_fixed32() {
+        auto value = std::uint32_t{0};
+        for (int i = 0; i < 4; ++i) {
+            value |= std::uint32_t(read_byte()) << (8 * i);
+        }
+        return value;
+    }
+
+    std::uint64_t read_fixed64() {
+        auto value = std::uint64_t{0};
+        for (int i = 0; i < 8; ++i) {
+            value |= std::uint64_t(read_byte()) << (8 * i);
+        }
+        return value;
+    }
+
+    void read_bytes(void* bytes, std::size_t size) {
+        check(size);
+        std::memcpy(bytes, data + cursor, size);
+        cursor += size;
+    }
+
+    void skip(std::size_t size) {
+        check(size);
+        cursor += size;
+    }
+
+    // Reads an element count, rejecting counts the remaining data could not hold, so corrupt
+    // input cannot make the caller allocate without bound.
+    std::size_t read_count(std::size_t min_element_size) {
+        auto count = read_varint();
+        if (count > (end - cursor) / min_element_size) {
+            throw std::runtime_error("Element count exceeds binary data.");
+        }
+        return std::size_t(count);
+    }
+
+    std::size_t position() const {
+        return cursor;
+    }
+
+    bool at_end() const {
+        return cursor == end;
+    }
+
+private:
+    void check(std::size_t size) const {
+        if (size > end - cursor) {
+            throw std::runtime_error("Unexpected end of binary data.");
+        }
+    }
+
+    const std::byte* data;
+    std::size_t end;
+    std::size_t cursor = 0;
+};
+
+namespace _detail {
+
+template <typename T>
+struct is_optional : std::false_type {};
+
+template <typename T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+template <typename T>
+struct is_array : std::false_type {};
+
+template <typename T, std::size_t N>
+struct is_array<std::array<T, N>> : std::true_type {};
+
+template <typename T>
+struct is_vector : std::false_type {};
+
+template <typename T>
+struct is_vector<std::vector<T>> : std::true_type {};
+
+template <typename T>
+struct is_glm_vec : std::false_type {};
+
+template <glm::length_t L, typename T, glm::qualifier Q>
+struct is_glm_vec<glm::vec<L, T, Q>> : std::true_type {};
+
+inline std::uint64_t zigzag(std::int64_t value) {
+    return (std::uint64_t(value) << 1) ^ std::uint64_t(value >> 63);
+}
+
+inline std::int64_t unzigzag(std::uint64_t value) {
+    return std::int64_t(value >> 1) ^ -std::int64_t(value & 1);
+}
+
+// How a type is encoded, for fingerprints.
+enum class kind : std::uint8_t {
+    boolean,
+    signed_integer,
+    unsigned_integer,
+    floating_point,
+    string,
+    optional,
+    array,
+    vector,
+    glm_vec,
+    record,
+};
+
+// FNV-1a over a type's encoding. Arithmetic types add their size, containers their element type,
+// and records their member names and types, so a member that changes type is noticed too.
+// Only portable properties are hashed, so fingerprints match between platforms.
+class fingerprinter {
+public:
+    void add(const char* str) {
+        for (; *str; ++str) {
+            add_byte(std::uint8_t(*str));
+        }
+        add_byte(0xff);
+    }
+
+    void add(std::uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            add_byte(std::uint8_t(value >> (8 * i)));
+        }
+    }
+
+    template <typename T>
+    void add_type() {
+        if constexpr (std::is_same_v<T, bool>) {
+            add_kind(kind::boolean);
+        } else if constexpr (std::is_enum_v<T>) {
+            add_type<std::underlying_type_t<T>>();
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            add_kind(std::is_floating_point_v<T> ? kind::floating_point :
+                     std::is_signed_v<T> ? kind::signed_integer :
+                     kind::unsigned_integer);
+            add(sizeof(T));
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            add_kind(kind::string);
+        } else if constexpr (is_optional<T>::value) {
+            add_kind(kind::optional);
+            add_type<typename T::value_type>();
+        } else if constexpr (is_array<T>::value) {
+            add_kind(kind::array);
+            add(std::tuple_size<T>::value);
+            add_type<typename T::value_type>();
+        } else if constexpr (is_vector<T>::value) {
+            add_kind(kind::vector);
+            add_type<typename T::value_type>();
+        } else if constexpr (is_glm_vec<T>::value) {
+            add_kind(kind::glm_vec);
+            add(std::uint64_t(T::length()));
+            add_type<typename T::value_type>();
+        } else {
+            static_assert(meta::isRegistered<T>(), "Type has no binary encoding.");
+            add_kind(kind::record);
+            meta::doForAllMembers<T>([&](auto& member) {
+                using member_type = meta::get_member_type<decltype(member)>;
+                add(member.getName());
+                add_type<member_type>();
+            });
+        }
+    }
+
+    std::uint32_t get() const {
+        return hash;
+    }
+
+private:
+    void add_byte(std::uint8_t byte) {
+        hash = (hash ^ byte) * 16777619u;
+    }
+
+    void add_kind(kind k) {
+        add_byte(std::uint8_t(k));
+    }
+
+    std::uint32_t hash = 2166136261u;
+};
+
+// Identifies a component's name and encoding, to detect layout changes.
+template <typename T>
+std::uint32_t fingerprint() {
+    auto hash = fingerprinter{};
+    hash.add(meta::getName<T>());
+    hash.add_type<T>();
+    return hash.get();
+}
+
+} //namespace _detail
+
+template <typename T>
+void encode(writer& out, const T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+        out.write_byte(value ? 1 : 0);
+    } else if constexpr (std::is_enum_v<T>) {
+        encode(out, std::underlying_type_t<T>(value));
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        out.write_varint(_detail::zigzag(value));
+    } else if constexpr (std::is_integral_v<T>) {
+        out.write_varint(value);
+    } else if constexpr (std::is_same_v<T, float>) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        out.write_fixed32(bits);
+    } else if constexpr (std::is_same_v<T, double>) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        out.write_fixed64(bits);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        out.write_varint(value.size());
+        out.write_bytes(value.data(), value.size());
+    } else if constexpr (_detail::is_optional<T>::value) {
+        out.write_byte(value ? 1 : 0);
+        if (value) {
+            encode(out, *value);
+        }
+    } else if constexpr (_detail::is_array<T>::value) {
+        for (const auto& element : value) {
+            encode(out, element);
+        }
+    } else if constexpr (_detail::is_vector<T>::value) {
+        out.write_varint(value.size());
+        for (const auto& element : value) {
+            encode(out, element);
+        }
+    } else if constexpr (_detail::is_glm_vec<T>::value) {
+        for (glm::length_t i = 0; i < value.length(); ++i) {
+            encode(out, value[i]);
+        }
+    } else {
+        static_assert(meta::isRegistered<T>(), "Type has no binary encoding.");
+        meta::doForAllMembers<T>([&](auto& member) {
+            encode(out, member.get(value));
+        });
+    }
+}
+
+template <typename T>
+void decode(reader& in, T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+        value = in.read_byte() != 0;
+    } else if constexpr (std::is_enum_v<T>) {
+        auto underlying = std::underlying_type_t<T>{};
+        decode(in, underlying);
+        value = T(underlying);
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        value = T(_detail::unzigzag(in.read_varint()));
+    } else if constexpr (std::is_integral_v<T>) {
+        value = T(in.read_varint());
+    } else if constexpr (std::is_same_v<T, float>) {
+        auto bits = in.read_fixed32();
+        std::memcpy(&value, &bits, sizeof(value));
+    } else if constexpr (std::is_same_v<T, double>) {
+        auto bits = in.read_fixed64();
+        std::memcpy(&value, &bits, sizeof(value));
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        value.resize(in.read_count(1));
+        in.read_bytes(value.data(), value.size());
+    } else if constexpr (_detail::is_optional<T>::value) {
+        if (in.read_byte()) {
+            value.emplace();
+            decode(in, *value);
+        } else {
+            value.reset();
+        }
+    } else if constexpr (_detail::is_array<T>::value) {
+        for (auto& element : value) {
+            decode(in, element);
+        }
+    } else if constexpr (_detail::is_vector<T>::value) {
+        // Every element takes at least a byte.
+        value.resize(in.read_count(1));
+        for (auto& element : value) {
+            decode(in, element);
+        }
+    } else if constexpr (_detail::is_glm_vec<T>::value) {
+        for (glm::length_t i = 0; i < value.length(); ++i) {
+            decode(in, value[i]);
+        }
+    } else {
+        static_assert(meta::isRegistered<T>(), "Type has no binary encoding.");
+        meta::doForAllMembers<T>([&](auto& member) {
+            using member_type = meta::get_member_type<decltype(member)>;
+            auto member_value = member_type{};
+            decode(in, member_value);
+            member.set(value, std::move(member_value));
+        });
+    }
+}
+
+namespace _detail {
+
+// Type table of a world file, by index in the file.
+struct type_entry {
+    std::string name;
+    std::uint32_t fingerprint;
+};
+
+template <typename Com>
+void encode_component(writer& out, ember_database& db, ember_database::ent_id eid, std::uint64_t type_index, std::uint64_t& count) {
+    if (!db.has_component<Com>(eid)) {
+        return;
+    }
+
+    out.write_varint(type_index);
+    auto length_offset = out.reserve_fixed32();
+    auto start = out.size();
+    encode(out, db.get_component<Com>(eid));
+    out.patch_fixed32(length_offset, std::uint32_t(out.size() - start));
+    ++count;
+}
+
+template <typename Com>
+bool decode_component(reader& in, ember_database& db, ember_database::ent_id eid, const type_entry& type) {
+    if (type.name != meta::getName<Com>()) {
+        return false;
+    }
+
+    auto com = Com{};
+    decode(in, com);
+    db.create_component(eid, std::move(com));
+    return true;
+}
+
+} //namespace _detail
+
+// Encodes every entity with a net_id, and their components of the given types.
+template <typename... Coms>
+std::vector<std::byte> save_world(ember_database& db, utility::type_list<Coms...>) {
+    auto bytes = std::vector<std::byte>{};
+    auto out = writer(bytes);
+
+    out.write_bytes(world_magic.data(), world_magic.size());
+    out.write_varint(format_version);
+
+    out.write_varint(sizeof...(Coms));
+    ((encode(out, std::string(meta::getName<Coms>())), out.write_fixed32(_detail::fingerprint<Coms>())), ...);
+
+    auto count_offset = out.reserve_fixed32();
+    auto entity_count = std::uint32_t{0};
+
+    db.visit([&](ember_database::ent_id eid, const component::net_id& id) {
+        encode(out, id.id);
+
+        auto components_offset = out.reserve_fixed32();
+        auto count = std::uint64_t{0};
+        auto type_index = std::uint64_t{0};
+        (_detail::encode_component<Coms>(out, db, eid, type_index++, count), ...);
+        out.patch_fixed32(components_offset, std::uint32_t(count));
+
+        ++entity_count;
+    });
+
+    out.patch_fixed32(count_offset, entity_count);
+
+    return bytes;
+}
+
+// Adds the entities in a world file to the database, and returns how many there were. Entities that
+// already exist under the same net_id are updated. Components of unknown types, or whose members
+// changed, are skipped.
+template <typename... Coms>
+std::size_t load_world(ember_database& db, const std::vector<std::byte>& bytes, utility::type_list<Coms...>) {
+    auto in = reader(bytes);
+
+    auto magic = std::array<char, 4>{};
+    in.read_bytes(magic.data(), magic.size());
+    if (magic != world_magic) {
+        throw std::runtime_error("Not a binary world file.");
+    }
+
+    auto version = in.read_varint();
+    if (version != format_version) {
+        throw std::runtime_error("Unsupported binary world version " + std::to_string(version) + ".");
+    }
+
+    // Each entry is at least an empty name's length and a fingerprint.
+    auto types = std::vector<_detail::type_entry>(in.read_count(5));
+    auto usable = std::vector<bool>(types.size());
+    for (auto i = std::size_t{0}; i < types.size(); ++i) {
+        decode(in, types[i].name);
+        types[i].fingerprint = in.read_fixed32();
+
+        usable[i] = ((types[i].name == meta::getName<Coms>() && types[i].fingerprint == _detail::fingerprint<Coms>()) || ...);
+        if (!usable[i]) {
+            std::clog << "Warning: Skipping component " << types[i].name << " in binary world, its layout is unknown." << std::endl;
+        }
+    }
+
+    auto entity_count = in.read_fixed32();
+    for (auto e = std::uint32_t{0}; e < entity_count; ++e) {
+        auto id = ember_database::net_id{};
+        decode(in, id);
+        auto eid = db.get_or_create_entity(id);
+
+        auto count = in.read_fixed32();
+        for (auto c = std::uint32_t{0}; c < count; ++c) {
+            auto type_index = in.read_varint();
+            auto length = in.read_fixed32();
+
+            if (type_index >= types.size() || !usable[type_index]) {
+                in.skip(length);
+                continue;
+            }
+
+            const auto& type = types[type_index];
+            (_detail::decode_component<Coms>(in, db, eid, type) || ...);
+        }
+    }
+
+    return entity_count;
+}
+
+} //namespace binary
+
+#endif //LD42_BINARY_SERIALIZER_HPP
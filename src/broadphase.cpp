@@ -0,0 +1,498 @@
+#include "broadphase.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+std::uint64_t cell_key(std::int32_t x, std::int32_t y) {
+    return (std::uint64_t(std::uint32_t(x)) << 32) | std::uint32_t(y);
+}
+
+// Overlap of two boxes, empty when they only touch.
+bool overlap(const component::aabb& a, const component::aabb& b, component::aabb& region) {
+    region.left = std::max(a.left, b.left);
+    region.right = std::min(a.right, b.right);
+    region.bottom = std::max(a.bottom, b.bottom);
+    region.top = std::min(a.top, b.top);
+    return region.left < region.right && region.bottom < region.top;
+}
+
+bool contains(const component::aabb& box, glm::vec2 point) {
+    return box.left <= point.x && point.x < box.right && box.bottom <= point.y && point.y < box.top;
+}
+
+float distance_to(const component::aabb& box, glm::vec2 point) {
+    auto dx = std::max({box.left - point.x, 0.f, point.x - box.right});
+    auto dy = std::max({box.bottom - point.y, 0.f, point.y - box.top});
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+// Slab test, gives the distance at which the ray enters the box, or 0 if it starts inside.
+bool ray_hits(const component::aabb& box, glm::vec2 origin, glm::vec2 inv_dir, float max_distance, float& distance) {
+    auto tx1 = (box.left - origin.x) * inv_dir.x;
+    auto tx2 = (box.right - origin.x) * inv_dir.x;
+    auto ty1 = (box.bottom - origin.y) * inv_dir.y;
+    auto ty2 = (box.top - origin.y) * inv_dir.y;
+
+    // Axis-parallel rays give NaN for boxes edge-on to them, which fmin/fmax ignore.
+    auto tmin = std::fmax(std::fmin(tx1, tx2), std::fmin(ty1, ty2));
+    auto tmax = std::fmin(std::fmax(tx1, tx2), std::fmax(ty1, ty2));
+
+    tmin = std::max(tmin, 0.f);
+
+    if (tmin > tmax || tmin > max_distance) {
+        return false;
+    }
+
+    distance = tmin;
+    return true;
+}
+
+} //namespace
+
+broadphase::broadphase(const nlohmann::json& config) :
+    cell_size(float(config["cell_size"]))
+{
+    auto mode_name = config["broadphase"].get<std::string>();
+
+    if (mode_name == "sap") {
+        bp_mode = mode::sweep_and_prune;
+    } else if (mode_name == "grid") {
+        bp_mode = mode::grid;
+    } else {
+        throw std::runtime_error("Unknown collision broadphase: " + mode_name);
+    }
+
+    if (!(cell_size > 0)) {
+        throw std::runtime_error("Collision cell_size must be positive.");
+    }
+}
+
+void broadphase::update(ember_database& db) {
+    using DB = ember_database;
+
+    auto place = [&](DB::ent_id eid, const component::net_id& id, const component::position& pos, const component::aabb& aabb) {
+        auto index = eid.get_index();
+
+        if (index >= slots.size()) {
+            slots.resize(index + 1, no_proxy);
+        }
+
+        auto& slot = slots[index];
+
+        // A proxy left behind by a destroyed entity with the same index is simply taken over.
+        if (slot == no_proxy) {
+            slot = std::uint32_t(proxies.size());
+            proxies.push_back({});
+            axis.push_back(slot);
+        }
+
+        auto& p = proxies[slot];
+        p.eid = eid;
+        p.id = id.id;
+        p.box.left = pos.x + aabb.left;
+        p.box.right = pos.x + aabb.right;
+        p.box.bottom = pos.y + aabb.bottom;
+        p.box.top = pos.y + aabb.top;
+    };
+
+    // Only boxes whose position or aabb was written since the last update need to move.
+    // Boxes written before tracking started have no stamps, so the first update places every one.
+    if (tracked_db != &db) {
+        db.track_changes<component::position>();
+        db.track_changes<component::aabb>();
+        db.visit(place);
+        tracked_db = &db;
+    } else {
+        db.visit_changed_since(synced_tick, place);
+    }
+
+    remove_stale(db);
+
+    synced_tick = db.get_change_tick();
+
+    max_width = 0;
+    for (const auto& p : proxies) {
+        max_width = std::max(max_width, p.box.right - p.box.left);
+    }
+
+    switch (bp_mode) {
+        case mode::sweep_and_prune:
+            sort_axis();
+            break;
+        case mode::grid:
+            rebuild_grid();
+            break;
+    }
+}
+
+void broadphase::sync(ember_database& db) {
+    if (synced_tick != db.get_change_tick()) {
+        update(db);
+    }
+}
+
+void broadphase::find_pairs(std::vector<pair>& out) {
+    switch (bp_mode) {
+        case mode::sweep_and_prune:
+            find_pairs_sap(out);
+            break;
+        case mode::grid:
+            find_pairs_grid(out);
+            break;
+    }
+}
+
+std::size_t broadphase::size() const {
+    return proxies.size();
+}
+
+void broadphase::remove_stale(ember_database& db) {
+    // Destroyed entities and components leave no change stamps, so every proxy is checked.
+    remap.resize(proxies.size());
+
+    auto stale = false;
+    for (auto i = std::uint32_t{0}; i < proxies.size(); ++i) {
+        const auto& p = proxies[i];
+        auto keep = is_live(db, p) &&
+            db.has_component<component::position>(p.eid) &&
+            db.has_component<component::aabb>(p.eid);
+        remap[i] = keep ? i : no_proxy;
+        stale = stale || !keep;
+    }
+
+    if (!stale) {
+        return;
+    }
+
+    auto live = std::uint32_t{0};
+    for (auto i = std::uint32_t{0}; i < proxies.size(); ++i) {
+        auto index = proxies[i].eid.get_index();
+        if (remap[i] != no_proxy) {
+            remap[i] = live;
+            slots[index] = live;
+            proxies[live++] = proxies[i];
+        } else {
+            slots[index] = no_proxy;
+        }
+    }
+
+    proxies.resize(live);
+
+    // Keeps the surviving proxies in their sorted order.
+    auto sorted_live = std::size_t{0};
+    auto out = begin(axis);
+    for (auto i = std::size_t{0}; i < axis.size(); ++i) {
+        if (remap[axis[i]] != no_proxy) {
+            *out++ = remap[axis[i]];
+            if (i < sorted_count) {
+                ++sorted_live;
+            }
+        }
+    }
+    axis.erase(out, end(axis));
+    sorted_count = sorted_live;
+}
+
+void broadphase::sort_axis() {
+    auto by_left = [&](std::uint32_t a, std::uint32_t b) {
+        return proxies[a].box.left < proxies[b].box.left;
+    };
+
+    // Entries from the last update are nearly in order, so few of them move far.
+    for (auto i = std::size_t{1}; i < sorted_count; ++i) {
+        auto value = axis[i];
+        auto hole = i;
+        while (hole > 0 && by_left(value, axis[hole - 1])) {
+            axis[hole] = axis[hole - 1];
+            --hole;
+        }
+        axis[hole] = value;
+    }
+
+    // New entries can be anywhere, so they are sorted on their own and merged in.
+    auto sorted_end = begin(axis) + sorted_count;
+    std::sort(sorted_end, end(axis), by_left);
+    std::inplace_merge(begin(axis), sorted_end, end(axis), by_left);
+
+    sorted_count = axis.size();
+}
+
+void broadphase::rebuild_grid() {
+    // Cells that stayed empty for a whole update are dropped, the rest keep their capacity.
+    for (auto iter = begin(cells); iter != end(cells);) {
+        if (iter->second.empty()) {
+            iter = cells.erase(iter);
+        } else {
+            iter->second.clear();
+            ++iter;
+        }
+    }
+
+    for (auto i = std::uint32_t{0}; i < proxies.size(); ++i) {
+        const auto& box = proxies[i].box;
+        auto x1 = cell_of(box.left);
+        auto x2 = cell_of(box.right);
+        auto y1 = cell_of(box.bottom);
+        auto y2 = cell_of(box.top);
+        for (auto x = x1; x <= x2; ++x) {
+            for (auto y = y1; y <= y2; ++y) {
+                cells[cell_key(x, y)].push_back(i);
+            }
+        }
+    }
+}
+
+void broadphase::find_pairs_sap(std::vector<pair>& out) const {
+    for (auto i = std::size_t{0}; i < axis.size(); ++i) {
+        const auto& a = proxies[axis[i]];
+
+        // Everything after the first box starting past this one's right edge starts past it too.
+        for (auto j = i + 1; j < axis.size(); ++j) {
+            const auto& b = proxies[axis[j]];
+
+            if (b.box.left >= a.box.right) {
+                break;
+            }
+
+            auto region = component::aabb{};
+            if (overlap(a.box, b.box, region)) {
+                out.push_back({a.eid, b.eid, region});
+            }
+        }
+    }
+}
+
+void broadphase::find_pairs_grid(std::vector<pair>& out) const {
+    for (const auto& [key, members] : cells) {
+        for (auto i = std::size_t{0}; i < members.size(); ++i) {
+            for (auto j = i + 1; j < members.size(); ++j) {
+                const auto& a = proxies[members[i]];
+                const auto& b = proxies[members[j]];
+
+                auto region = component::aabb{};
+                if (!overlap(a.box, b.box, region)) {
+                    continue;
+                }
+
+                // A pair sharing several cells is only reported by the one holding its overlap's corner.
+                if (cell_key(cell_of(region.left), cell_of(region.bottom)) == key) {
+                    out.push_back({a.eid, b.eid, region});
+                }
+            }
+        }
+    }
+}
+
+void broadphase::query_aabb(ember_database& db, const component::aabb& box, std::vector<ember_database::ent_id>& out) const {
+    auto region = component::aabb{};
+
+    // Large boxes are cheaper to check against every proxy than cell by cell.
+    auto cell_count = (std::floor(box.right / cell_size) - std::floor(box.left / cell_size) + 1) *
+                      (std::floor(box.top / cell_size) - std::floor(box.bottom / cell_size) + 1);
+
+    if (bp_mode == mode::grid && cell_count <= float(proxies.size())) {
+        auto x1 = cell_of(box.left);
+        auto x2 = cell_of(box.right);
+        auto y1 = cell_of(box.bottom);
+        auto y2 = cell_of(box.top);
+        for (auto x = x1; x <= x2; ++x) {
+            for (auto y = y1; y <= y2; ++y) {
+                auto members = find_cell(x, y);
+                if (!members) {
+                    continue;
+                }
+                for (auto i : *members) {
+                    const auto& p = proxies[i];
+                    // A box in several of the cells is only reported by the first one.
+                    if (std::max(cell_of(p.box.left), x1) == x && std::max(cell_of(p.box.bottom), y1) == y && overlap(p.box, box, region) && is_live(db, p)) {
+                        out.push_back(p.eid);
+                    }
+                }
+            }
+        }
+    } else if (bp_mode == mode::sweep_and_prune) {
+        for (auto i = first_candidate(box.left); i < axis.size() && proxies[axis[i]].box.left < box.right; ++i) {
+            const auto& p = proxies[axis[i]];
+            if (overlap(p.box, box, region) && is_live(db, p)) {
+                out.push_back(p.eid);
+            }
+        }
+    } else {
+        for (const auto& p : proxies) {
+            if (overlap(p.box, box, region) && is_live(db, p)) {
+                out.push_back(p.eid);
+            }
+        }
+    }
+}
+
+void broadphase::query_point(ember_database& db, glm::vec2 point, std::vector<ember_database::ent_id>& out) const {
+    switch (bp_mode) {
+        case mode::sweep_and_prune: {
+            for (auto i = first_candidate(point.x); i < axis.size() && proxies[axis[i]].box.left <= point.x; ++i) {
+                const auto& p = proxies[axis[i]];
+                if (contains(p.box, point) && is_live(db, p)) {
+                    out.push_back(p.eid);
+                }
+            }
+            break;
+        }
+        case mode::grid: {
+            if (auto members = find_cell(cell_of(point.x), cell_of(point.y))) {
+                for (auto i : *members) {
+                    if (contains(proxies[i].box, point) && is_live(db, proxies[i])) {
+                        out.push_back(proxies[i].eid);
+                    }
+                }
+            }
+            break;
+        }
+    }
+}
+
+auto broadphase::raycast(ember_database& db, glm::vec2 origin, glm::vec2 direction, float max_distance) const -> std::optional<raycast_hit> {
+    auto length = glm::length(direction);
+
+    if (!(length > 0)) {
+        return std::nullopt;
+    }
+
+    auto dir = direction / length;
+    auto inv_dir = 1.f / dir;
+    auto best = std::optional<raycast_hit>{};
+
+    auto test = [&](const proxy& p) {
+        auto distance = 0.f;
+        if (ray_hits(p.box, origin, inv_dir, best ? best->distance : max_distance, distance) && is_live(db, p)) {
+            if (!best || distance < best->distance) {
+                best = raycast_hit{p.eid, distance};
+            }
+        }
+    };
+
+    auto end_point = origin + dir * max_distance;
+    auto cells_crossed = std::abs(end_point.x - origin.x) / cell_size + std::abs(end_point.y - origin.y) / cell_size + 2;
+
+    if (bp_mode == mode::grid && cells_crossed <= float(proxies.size())) {
+        // Walks the cells along the ray, stopping once the best hit comes before the next cell.
+        auto cx = cell_of(origin.x);
+        auto cy = cell_of(origin.y);
+        auto step_x = dir.x > 0 ? 1 : -1;
+        auto step_y = dir.y > 0 ? 1 : -1;
+        auto inf = std::numeric_limits<float>::infinity();
+        auto next_x = dir.x != 0 ? ((cx + (dir.x > 0)) * cell_size - origin.x) / dir.x : inf;
+        auto next_y = dir.y != 0 ? ((cy + (dir.y > 0)) * cell_size - origin.y) / dir.y : inf;
+        auto delta_x = dir.x != 0 ? cell_size / std::abs(dir.x) : inf;
+        auto delta_y = dir.y != 0 ? cell_size / std::abs(dir.y) : inf;
+        auto t = 0.f;
+
+        while (t <= max_distance) {
+            if (auto members = find_cell(cx, cy)) {
+                for (auto i : *members) {
+                    test(proxies[i]);
+                }
+            }
+
+            auto next_t = std::min(next_x, next_y);
+            if (best && best->distance <= next_t) {
+                break;
+            }
+
+            if (next_x < next_y) {
+                cx += step_x;
+                t = next_x;
+                next_x += delta_x;
+            } else {
+                cy += step_y;
+                t = next_y;
+                next_y += delta_y;
+            }
+        }
+    } else if (bp_mode == mode::sweep_and_prune) {
+        auto left = std::min(origin.x, end_point.x);
+        auto right = std::max(origin.x, end_point.x);
+        for (auto i = first_candidate(left); i < axis.size() && proxies[axis[i]].box.left <= right; ++i) {
+            test(proxies[axis[i]]);
+        }
+    } else {
+        for (const auto& p : proxies) {
+            test(p);
+        }
+    }
+
+    return best;
+}
+
+std::optional<ember_database::ent_id> broadphase::nearest(ember_database& db, glm::vec2 point, float max_distance) const {
+    auto best = std::optional<ember_database::ent_id>{};
+    auto best_distance = max_distance;
+
+    auto test = [&](const proxy& p) {
+        auto distance = distance_to(p.box, point);
+        if (distance <= best_distance && (!best || distance < best_distance) && is_live(db, p)) {
+            best = p.eid;
+            best_distance = distance;
+        }
+    };
+
+    auto max_ring = std::ceil(max_distance / cell_size);
+    auto ring_cells = (2 * max_ring + 1) * (2 * max_ring + 1);
+
+    if (bp_mode == mode::grid && ring_cells <= float(proxies.size())) {
+        // Cells in ring r+1 are at least r cells away from the point.
+        auto cx = cell_of(point.x);
+        auto cy = cell_of(point.y);
+        for (auto r = std::int32_t{0}; r <= std::int32_t(max_ring); ++r) {
+            for (auto x = cx - r; x <= cx + r; ++x) {
+                for (auto y = cy - r; y <= cy + r; y += (x == cx - r || x == cx + r) ? 1 : 2 * r) {
+                    if (auto members = find_cell(x, y)) {
+                        for (auto i : *members) {
+                            test(proxies[i]);
+                        }
+                    }
+                }
+            }
+            if (best && best_distance <= r * cell_size) {
+                break;
+            }
+        }
+    } else if (bp_mode == mode::sweep_and_prune && std::isfinite(max_distance)) {
+        auto right = point.x + max_distance;
+        for (auto i = first_candidate(point.x - max_distance); i < axis.size() && proxies[axis[i]].box.left <= right; ++i) {
+            test(proxies[axis[i]]);
+        }
+    } else {
+        for (const auto& p : proxies) {
+            test(p);
+        }
+    }
+
+    return best;
+}
+
+bool broadphase::is_live(ember_database& db, const proxy& p) {
+    auto eid = db.find_entity(p.id);
+    return eid && *eid == p.eid;
+}
+
+std::int32_t broadphase::cell_of(float coord) const {
+    return std::int32_t(std::floor(coord / cell_size));
+}
+
+const std::vector<std::uint32_t>* broadphase::find_cell(std::int32_t x, std::int32_t y) const {
+    auto iter = cells.find(cell_key(x, y));
+    return iter != cells.end() ? &iter->second : nullptr;
+}
+
+std::size_t broadphase::first_candidate(float left) const {
+    // No box is wider than max_width, so none starting further left can reach `left`.
+    auto iter = std::lower_bound(begin(axis), end(axis), left - max_width, [&](std::uint32_t i, float value) {
+        return proxies[i].box.left < value;
+    });
+    return std::size_t(iter - begin(axis));
+}
@@ -0,0 +1,110 @@
+#ifndef LD42_BROADPHASE_HPP
+#define LD42_BROADPHASE_HPP
+
+#include "components.hpp"
+#include "entities.hpp"
+#include "json.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Collision broadphase over every entity with a position and an aabb.
+//
+// Proxies persist between updates, so the work per frame follows how much the world changed.
+// Updates track changes to position and aabb, and only move the proxies of entities where either
+// was written since, so writes through get_component must be followed by mark_changed.
+//
+// In sweep-and-prune mode, proxies are kept sorted by their left edge. Boxes move little between
+// frames, so an insertion sort restores the order in close to linear time.
+//
+// In grid mode, proxies are bucketed into square cells each update, which suits dense scenes where
+// many boxes share the same span on the x axis.
+//
+// The same proxies answer spatial queries. Results reflect the boxes as of the last update, minus
+// entities destroyed since, and queries append to a caller-owned vector so that it can be reused.
+class broadphase {
+public:
+    enum class mode {
+        sweep_and_prune,
+        grid,
+    };
+
+    struct pair {
+        ember_database::ent_id eid1;
+        ember_database::ent_id eid2;
+        component::aabb region;
+    };
+
+    struct raycast_hit {
+        ember_database::ent_id eid;
+        float distance;
+    };
+
+    broadphase() = default;
+    explicit broadphase(const nlohmann::json& config);
+
+    // Moves proxies to their entities' current boxes, adding and removing proxies as needed.
+    //
+    // The first update with a database enables change tracking for position and aabb on it.
+    void update(ember_database& db);
+
+    // Updates unless the database's change tick has not advanced since the last update.
+    void sync(ember_database& db);
+
+    // Appends every pair of overlapping proxies to `out`, along with their overlap region.
+    void find_pairs(std::vector<pair>& out);
+
+    // Appends every entity whose box overlaps `box` to `out`.
+    void query_aabb(ember_database& db, const component::aabb& box, std::vector<ember_database::ent_id>& out) const;
+
+    // Appends every entity whose box contains the point to `out`.
+    void query_point(ember_database& db, glm::vec2 point, std::vector<ember_database::ent_id>& out) const;
+
+    // Finds the first box hit by a ray, within `max_distance` along the normalized `direction`.
+    std::optional<raycast_hit> raycast(ember_database& db, glm::vec2 origin, glm::vec2 direction, float max_distance) const;
+
+    // Finds the entity whose box is closest to the point, within `max_distance`.
+    std::optional<ember_database::ent_id> nearest(ember_database& db, glm::vec2 point, float max_distance) const;
+
+    // Number of proxies.
+    std::size_t size() const;
+
+private:
+    struct proxy {
+        ember_database::ent_id eid;
+        ember_database::net_id id;  // Tells a destroyed entity from a new one reusing its index.
+        component::aabb box;
+    };
+
+    static constexpr auto no_proxy = ~std::uint32_t{0};
+
+    void remove_stale(ember_database& db);
+    void sort_axis();
+    void rebuild_grid();
+    void find_pairs_sap(std::vector<pair>& out) const;
+    void find_pairs_grid(std::vector<pair>& out) const;
+
+    static bool is_live(ember_database& db, const proxy& p);
+
+    std::int32_t cell_of(float coord) const;
+    const std::vector<std::uint32_t>* find_cell(std::int32_t x, std::int32_t y) const;
+    std::size_t first_candidate(float left) const;
+
+    mode bp_mode = mode::sweep_and_prune;
+    float cell_size = 1;
+    const ember_database* tracked_db = nullptr;
+    std::uint64_t synced_tick = 0;
+    float max_width = 0;
+    std::vector<proxy> proxies;
+    std::vector<std::uint32_t> slots;
+    std::size_t sorted_count = 0;
+    std::vector<std::uint32_t> axis;
+    std::vector<std::uint32_t> remap;
+    std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> cells;
+};
+
+#endif //LD42_BROADPHASE_HPP
@@ -6,10 +6,32 @@
 #include "entities.hpp"
 #include "glm_json.hpp"
 
+#include <optional>
 #include <type_traits>
 #include <utility>
 #include <iostream>
 
+// Partial specializations for std::optional
+namespace nlohmann {
+    template <typename T>
+    struct adl_serializer<std::optional<T>> {
+        static void to_json(json& j, const std::optional<T>& opt) {
+            if (opt) {
+                j = *opt;
+            } else {
+                j = nullptr;
+            }
+        }
+        static void from_json(const json& j, std::optional<T>& opt) {
+            if (j.is_null()) {
+                opt = std::nullopt;
+            } else {
+                opt = j.get<T>();
+            }
+        }
+    };
+}
+
 namespace component {
 namespace _detail {
 
@@ -34,6 +56,8 @@ void new_component_usertype(sol::table& lua, const std::string& name, Args&&...
             if (!db.has_component<T>(eid)) {
                 std::cerr << "ERROR: Attempting to get nonexistant component " << name << " from entity " << eid.get_index() << std::endl;
             }
+            // Scripts can write through the reference, so handing it out counts as a write.
+            db.mark_changed<T>(eid);
             return std::ref(db.get_component<T>(eid));
         },
         "_has_component", [=](ember_database& db, ember_database::ent_id eid) {
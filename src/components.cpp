@@ -2,29 +2,6 @@
 
 #include "component_scripting.hpp"
 
-#include <optional>
-
-// Partial specializations for std::optional
-namespace nlohmann {
-    template <typename T>
-    struct adl_serializer<std::optional<T>> {
-        static void to_json(json& j, const std::optional<T>& opt) {
-            if (opt) {
-                j = *opt;
-            } else {
-                j = nullptr;
-            }
-        }
-        static void from_json(const json& j, std::optional<T>& opt) {
-            if (j.is_null()) {
-                opt = std::nullopt;
-            } else {
-                opt = j.get<T>();
-            }
-        }
-    };
-}
-
 namespace component {
 
 void register_components(sol::table& component_table) {
@@ -6,6 +6,7 @@
 #include "json.hpp"
 #include "scripting.hpp"
 #include "entities.hpp"
+#include "utility.hpp"
 
 #include <Meta.h>
 
@@ -16,6 +17,7 @@
 #include <memory>
 #include <chrono>
 #include <optional>
+#include <cstdint>
 
 #define REGISTER(NAME, ...)                                           \
         }                                                             \
@@ -31,6 +33,8 @@
         namespace component {
 #define MEMBER(FIELD) member(#FIELD, &comtype::FIELD)
 
+struct script_handles;
+
 namespace component {
 
 void register_components(sol::table& component_table);
@@ -51,6 +55,15 @@ REGISTER(position,
          MEMBER(x),
          MEMBER(y))
 
+struct previous_position {
+    float x = 0;
+    float y = 0;
+};
+
+REGISTER(previous_position,
+         MEMBER(x),
+         MEMBER(y))
+
 struct velocity {
     float vx = 0;
     float vy = 0;
@@ -75,6 +88,10 @@ REGISTER(aabb,
 
 struct script {
     std::string name;
+
+    // Cached by resource_manager::get_script_handles, not serialized.
+    const script_handles* handles = nullptr;
+    std::uint64_t handles_generation = 0;
 };
 
 REGISTER(script,
@@ -150,6 +167,20 @@ REGISTER(particle,
          MEMBER(spin),
          MEMBER(color))
 
+// Every component type besides net_id, which ember_database manages itself.
+using all_components = utility::type_list<
+    position,
+    previous_position,
+    velocity,
+    aabb,
+    script,
+    animation,
+    death_timer,
+    shape,
+    board,
+    block,
+    particle>;
+
 } //namespace component
 
 #undef MEMBER
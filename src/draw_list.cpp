@@ -0,0 +1,31 @@
+#include "draw_list.hpp"
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <sushi/shader.hpp>
+
+void draw_list::clear() {
+    sprites.clear();
+}
+
+void draw_list::set_camera(const glm::mat4& proj, const glm::mat4& view) {
+    this->proj = proj;
+    this->view = view;
+}
+
+void draw_list::add_sprite(std::string texture, const glm::mat4& modelmat, const glm::vec4& tint) {
+    sprites.push_back({std::move(texture), modelmat, tint});
+}
+
+auto draw_list::get_sprites() const -> const std::vector<sprite>& {
+    return sprites;
+}
+
+void draw_list::submit(resource_cache<sushi::texture_2d>& texture_cache, const sushi::static_mesh& mesh) const {
+    for (const auto& s : sprites) {
+        sushi::set_texture(0, *texture_cache.get(s.texture));
+        sushi::set_uniform("normal_mat", glm::inverseTranspose(view * s.modelmat));
+        sushi::set_uniform("MVP", (proj * view * s.modelmat));
+        sushi::set_uniform("tint", s.tint);
+        sushi::draw_mesh(mesh);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef LD42_DRAW_LIST_HPP
+#define LD42_DRAW_LIST_HPP
+
+#include "resource_cache.hpp"
+
+#include <glm/glm.hpp>
+#include <sushi/mesh.hpp>
+#include <sushi/texture.hpp>
+
+#include <string>
+#include <vector>
+
+// Sprites for one frame of the scene. Filling one does not touch GL, so it can be built off the main thread.
+class draw_list {
+public:
+    struct sprite {
+        std::string texture;
+        glm::mat4 modelmat;
+        glm::vec4 tint;
+    };
+
+    void clear();
+
+    void set_camera(const glm::mat4& proj, const glm::mat4& view);
+    void add_sprite(std::string texture, const glm::mat4& modelmat, const glm::vec4& tint = {1, 1, 1, 1});
+
+    const std::vector<sprite>& get_sprites() const;
+
+    // Issues the GL calls, with the current program. Must be called on the main thread.
+    void submit(resource_cache<sushi::texture_2d>& texture_cache, const sushi::static_mesh& mesh) const;
+
+private:
+    glm::mat4 proj = glm::mat4(1.f);
+    glm::mat4 view = glm::mat4(1.f);
+    std::vector<sprite> sprites;
+};
+
+#endif //LD42_DRAW_LIST_HPP
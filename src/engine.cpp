@@ -1,5 +1,6 @@
 #include "engine.hpp"
 
+#include "binary_serializer.hpp"
 #include "components.hpp"
 #include "component_scripting.hpp"
 #include "sprite.hpp"
@@ -10,13 +11,19 @@
 #include "sushi/sushi.hpp"
 
 #include <algorithm>
+#include <array>
+#include <cstddef>
+#include <fstream>
+#include <limits>
+#include <tuple>
 #include <iostream>
 #include <string>
 #include <cmath>
 #include <vector>
+#include <thread>
 #include <unordered_map>
 
-ld42_engine::ld42_engine() {
+ld42_engine::ld42_engine(bool headless) : headless(headless) {
     std::cout << "Init..." << std::endl;
     
     running = true;
@@ -29,18 +36,40 @@ ld42_engine::ld42_engine() {
     nlohmann_table.new_usertype<nlohmann::json>("json");
 
     lua["entities"] = std::ref(entities);
+    lua["profiler"] = std::ref(frame_profiler);
+
+    frame_sections.frame = &frame_profiler.get_section("frame");
+    frame_sections.sim_wait = &frame_profiler.get_section("sim_wait");
+    frame_sections.input = &frame_profiler.get_section("input");
+    frame_sections.actions = &frame_profiler.get_section("actions");
+    frame_sections.flush = &frame_profiler.get_section("flush");
+    frame_sections.compact = &frame_profiler.get_section("compact");
+    frame_sections.draw = &frame_profiler.get_section("draw");
+    frame_sections.render = &frame_profiler.get_section("render");
+    frame_sections.gui = &frame_profiler.get_section("gui");
+    frame_sections.swap = &frame_profiler.get_section("swap");
+    frame_sections.jobs = &frame_profiler.get_section("jobs");
+    for (auto i = std::size_t{0}; i < input::action_count; ++i) {
+        frame_sections.latency[i] = &frame_profiler.get_section(std::string("latency_") + input::get_name(input::action(i)));
+    }
 
     auto global_table = sol::table(lua.globals());
     scripting::register_type<ember_database>(global_table);
+    scripting::register_type<profiler>(global_table);
 
     auto component_table = lua.create_named_table("component");
     component::register_components(component_table);
 
-    input_table = lua.create_named_table("input");
+    lua["input"] = std::ref(actions);
+    scripting::register_type<input::action_table>(global_table);
 
     std::cout << "Initializing soloud..." << std::endl;
 
-    soloud.init();
+    if (headless) {
+        soloud.init(SoLoud::Soloud::CLIP_ROUNDOFF, SoLoud::Soloud::NULLDRIVER);
+    } else {
+        soloud.init();
+    }
 
     std::cout << "Loading config..." << std::endl;
 
@@ -50,6 +79,37 @@ ld42_engine::ld42_engine() {
     display_height = int(config["display"]["height"]);
     aspect_ratio = float(display_width) / float(display_height);
 
+    tick_rate = double(config["simulation"]["tick_rate"]);
+    // At least one tick, or the simulation would never advance.
+    max_ticks_per_frame = std::max(1, int(config["simulation"]["max_ticks_per_frame"]));
+
+    entities.enable_archetypes(config["entities"]["storage"] == "archetype");
+    compact_each_tick = bool(config["entities"]["compact_each_tick"]);
+
+    gc = gc_policy(lua.lua_state(), config["lua_gc"]);
+
+    spatial = broadphase(config["collision"]);
+    batch_collisions = bool(config["collision"]["batch_callbacks"]);
+
+    actions = input::action_table(config["input"]);
+
+    pacer = frame_pacer(config["pacing"]);
+
+    std::cout << "Starting job system..." << std::endl;
+
+    {
+        // A negative thread count leaves one core for the main thread.
+        auto threads = int(config["jobs"]["threads"]);
+        if (threads < 0) {
+            threads = std::max(int(std::thread::hardware_concurrency()) - 1, 0);
+        }
+        jobs = std::make_unique<job_system>(threads);
+    }
+
+    // Pipelining needs a worker to simulate on, and a renderer to overlap with.
+    pipelined = bool(config["simulation"]["pipelined"]) && !headless && jobs->get_worker_count() > 0;
+    front_frame = 0;
+
     std::cout << "Creating caches..." << std::endl;
 
     resources = resource_manager(config, lua);
@@ -59,70 +119,141 @@ ld42_engine::ld42_engine() {
     lua["play_sfx"] = [&](const std::string& name){ play_sfx(name); };
     lua["play_music"] = [&](const std::string& name){ play_music(name); };
     lua["entity_from_json"] = [&](const nlohmann::json& json){ return entity_from_json(json); };
+    lua["spawn_prefab"] = sol::overload(
+        [&](const std::string& name){ return spawn_prefab(name); },
+        [&](const std::string& name, const nlohmann::json& overrides){ return spawn_prefab(name, overrides); });
+    lua["reload_script"] = [&](const std::string& name){ resources.reload_script(name); };
+    // Scripts run inside visits, so the world is replaced at the end of the tick instead.
+    lua["load_world_file"] = [&](const std::string& path){ pending_world_file = path; };
+    lua["save_world_file"] = [&](const std::string& path){ save_world_file(path); };
+
+    // Queries refill a table passed in by the script, so repeated queries need not allocate.
+    auto fill_results = [this](sol::optional<sol::table> out) {
+        auto table = out ? *out : lua.create_table(int(query_results.size()), 0);
+        auto old_size = table.size();
+        auto count = std::size_t{0};
+        for (auto eid : query_results) {
+            table[++count] = eid;
+        }
+        for (auto i = count + 1; i <= old_size; ++i) {
+            table[i] = sol::nil;
+        }
+        return table;
+    };
 
-    std::cout << "Initializing SDL..." << std::endl;
+    lua["spatial"] = lua.create_table_with(
+        "query_aabb", [this, fill_results](const component::aabb& box, sol::optional<sol::table> out) {
+            spatial.sync(entities);
+            query_results.clear();
+            spatial.query_aabb(entities, box, query_results);
+            return fill_results(out);
+        },
+        "query_point", [this, fill_results](float x, float y, sol::optional<sol::table> out) {
+            spatial.sync(entities);
+            query_results.clear();
+            spatial.query_point(entities, {x, y}, query_results);
+            return fill_results(out);
+        },
+        "raycast", [this](float x, float y, float dx, float dy, sol::optional<float> max_distance) {
+            spatial.sync(entities);
+            auto hit = spatial.raycast(entities, {x, y}, {dx, dy}, max_distance.value_or(std::numeric_limits<float>::infinity()));
+            if (!hit) {
+                return std::make_tuple(sol::make_object(lua, sol::nil), sol::make_object(lua, sol::nil));
+            }
+            return std::make_tuple(sol::make_object(lua, hit->eid), sol::make_object(lua, hit->distance));
+        },
+        "nearest", [this](float x, float y, sol::optional<float> max_distance) {
+            spatial.sync(entities);
+            auto eid = spatial.nearest(entities, {x, y}, max_distance.value_or(std::numeric_limits<float>::infinity()));
+            if (!eid) {
+                return sol::make_object(lua, sol::nil);
+            }
+            return sol::make_object(lua, *eid);
+        });
 
-    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
-        throw std::runtime_error(SDL_GetError());
-    }
+    if (headless) {
+        std::cout << "Running headless, skipping SDL and GL..." << std::endl;
 
-    std::cout << "Opening window..." << std::endl;
+        g_window = nullptr;
+        glcontext = nullptr;
+        renderer = std::make_unique<null_renderer>();
+    } else {
+        std::cout << "Initializing SDL..." << std::endl;
 
-    g_window = SDL_CreateWindow("LD42 - Tetromatcher", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, display_width, display_height, SDL_WINDOW_OPENGL|SDL_WINDOW_RESIZABLE);
+        if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+            throw std::runtime_error(SDL_GetError());
+        }
 
-    std::cout << "Setting window attributes..." << std::endl;
+        std::cout << "Opening window..." << std::endl;
 
-    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
-    SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
-    platform::set_gl_version();
+        g_window = SDL_CreateWindow("LD42 - Tetromatcher", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, display_width, display_height, SDL_WINDOW_OPENGL|SDL_WINDOW_RESIZABLE);
 
-    std::cout << "Creating GL context..." << std::endl;
+        std::cout << "Setting window attributes..." << std::endl;
 
-    glcontext = SDL_GL_CreateContext(g_window);
+        SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+        SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+        SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
+        platform::set_gl_version();
 
-    platform::load_gl_extensions();
+        std::cout << "Creating GL context..." << std::endl;
 
-    std::cout << "Loading shaders..." << std::endl;
+        glcontext = SDL_GL_CreateContext(g_window);
 
-    auto shader_path = platform::get_shader_path();
+        platform::load_gl_extensions();
 
-    program = sushi::link_program({
-        sushi::compile_shader_file(sushi::shader_type::VERTEX, shader_path + "/basic.vert"),
-        sushi::compile_shader_file(sushi::shader_type::FRAGMENT, shader_path + "/basic.frag"),
-    });
+        pacer.apply_swap_interval();
 
-    program_msdf = sushi::link_program({
-        sushi::compile_shader_file(sushi::shader_type::VERTEX, shader_path + "/msdf.vert"),
-        sushi::compile_shader_file(sushi::shader_type::FRAGMENT, shader_path + "/msdf.frag"),
-    });
+        std::cout << "Loading shaders..." << std::endl;
 
-    sushi::set_program(program);
-    sushi::set_uniform("s_texture", 0);
-    glBindAttribLocation(program.get(), sushi::attrib_location::POSITION, "position");
-    glBindAttribLocation(program.get(), sushi::attrib_location::TEXCOORD, "texcoord");
-    glBindAttribLocation(program.get(), sushi::attrib_location::NORMAL, "normal");
+        auto shader_path = platform::get_shader_path();
 
-    sushi::set_program(program_msdf);
-    glBindAttribLocation(program_msdf.get(), sushi::attrib_location::POSITION, "position");
-    glBindAttribLocation(program_msdf.get(), sushi::attrib_location::TEXCOORD, "texcoord");
-    glBindAttribLocation(program_msdf.get(), sushi::attrib_location::NORMAL, "normal");
+        program = sushi::link_program({
+            sushi::compile_shader_file(sushi::shader_type::VERTEX, shader_path + "/basic.vert"),
+            sushi::compile_shader_file(sushi::shader_type::FRAGMENT, shader_path + "/basic.frag"),
+        });
 
-    std::cout << "Loading common GPU objects..." << std::endl;
+        program_msdf = sushi::link_program({
+            sushi::compile_shader_file(sushi::shader_type::VERTEX, shader_path + "/msdf.vert"),
+            sushi::compile_shader_file(sushi::shader_type::FRAGMENT, shader_path + "/msdf.frag"),
+        });
 
-    framebuffer = sushi::create_framebuffer(utility::vectorify(sushi::create_uninitialized_texture_2d(320, 240)));
-    framebuffer_mesh = make_sprite_mesh(framebuffer.color_texs[0]);
+        sushi::set_program(program);
+        sushi::set_uniform("s_texture", 0);
+        glBindAttribLocation(program.get(), sushi::attrib_location::POSITION, "position");
+        glBindAttribLocation(program.get(), sushi::attrib_location::TEXCOORD, "texcoord");
+        glBindAttribLocation(program.get(), sushi::attrib_location::NORMAL, "normal");
 
-    sprite_mesh = sushi::load_static_mesh_data(
-        {{-0.5f, 0.5f, 0.f},{-0.5f, -0.5f, 0.f},{0.5f, -0.5f, 0.f},{0.5f, 0.5f, 0.f}},
-        {{0.f, 1.f, 0.f},{0.f, 1.f, 0.f},{0.f, 1.f, 0.f},{0.f, 1.f, 0.f}},
-        {{0.f, 0.f},{0.f, 1.f},{1.f, 1.f},{1.f, 0.f}},
-        {{{{0,0,0},{1,1,1},{2,2,2}}},{{{2,2,2},{3,3,3},{0,0,0}}}}
-    );
+        sushi::set_program(program_msdf);
+        glBindAttribLocation(program_msdf.get(), sushi::attrib_location::POSITION, "position");
+        glBindAttribLocation(program_msdf.get(), sushi::attrib_location::TEXCOORD, "texcoord");
+        glBindAttribLocation(program_msdf.get(), sushi::attrib_location::NORMAL, "normal");
 
-    std::cout << "Initializing GUI..." << std::endl;
+        std::cout << "Loading common GPU objects..." << std::endl;
 
-    renderer = sushi_renderer({320, 240}, program, program_msdf, resources.font_cache, resources.texture_cache);
+        framebuffer = sushi::create_framebuffer(utility::vectorify(sushi::create_uninitialized_texture_2d(320, 240)));
+        framebuffer_mesh = make_sprite_mesh(framebuffer.color_texs[0]);
+
+        sprite_mesh = sushi::load_static_mesh_data(
+            {{-0.5f, 0.5f, 0.f},{-0.5f, -0.5f, 0.f},{0.5f, -0.5f, 0.f},{0.5f, 0.5f, 0.f}},
+            {{0.f, 1.f, 0.f},{0.f, 1.f, 0.f},{0.f, 1.f, 0.f},{0.f, 1.f, 0.f}},
+            {{0.f, 0.f},{0.f, 1.f},{1.f, 1.f},{1.f, 0.f}},
+            {{{{0,0,0},{1,1,1},{2,2,2}}},{{{2,2,2},{3,3,3},{0,0,0}}}}
+        );
+
+        renderer = std::make_unique<sushi_renderer>(glm::vec2{320, 240}, program, program_msdf, resources.font_cache, resources.texture_cache);
+
+        std::cout << "Prewarming glyphs..." << std::endl;
+
+        {
+            std::string printable;
+            for (auto c = ' '; c <= '~'; ++c) {
+                printable.push_back(c);
+            }
+            resources.font_cache.get("LiberationSans-Regular")->preload(printable, *jobs);
+        }
+    }
+
+    std::cout << "Initializing GUI..." << std::endl;
 
     gui_screen = gui::screen({320, 240});
     gui_screen.show();
@@ -134,8 +265,8 @@ ld42_engine::ld42_engine() {
     score_stamp = std::make_shared<gui::label>();
     score_stamp->set_position({0,-1});
     score_stamp->set_font("LiberationSans-Regular");
-    score_stamp->set_size(renderer, 10);
-    score_stamp->set_text(renderer, "Score: 0");
+    score_stamp->set_size(*renderer, 10);
+    score_stamp->set_text(*renderer, "Score: 0");
     score_stamp->set_color({1,1,1,1});
     score_stamp->show();
     root_widget->add_child(score_stamp);
@@ -143,8 +274,8 @@ ld42_engine::ld42_engine() {
     lines_stamp = std::make_shared<gui::label>();
     lines_stamp->set_position({0,-25});
     lines_stamp->set_font("LiberationSans-Regular");
-    lines_stamp->set_size(renderer, 10);
-    lines_stamp->set_text(renderer, "Lines: 0");
+    lines_stamp->set_size(*renderer, 10);
+    lines_stamp->set_text(*renderer, "Lines: 0");
     lines_stamp->set_color({1,1,1,1});
     lines_stamp->show();
     root_widget->add_child(lines_stamp);
@@ -153,8 +284,8 @@ ld42_engine::ld42_engine() {
         auto restart_stamp = std::make_shared<gui::label>();
         restart_stamp->set_position({240, 24});
         restart_stamp->set_font("LiberationSans-Regular");
-        restart_stamp->set_size(renderer, 8);
-        restart_stamp->set_text(renderer, "R to restart");
+        restart_stamp->set_size(*renderer, 8);
+        restart_stamp->set_text(*renderer, "R to restart");
         restart_stamp->set_color({1, 1, 1, 1});
         restart_stamp->show();
         root_widget->add_child(restart_stamp);
@@ -164,8 +295,8 @@ ld42_engine::ld42_engine() {
         auto music_stamp = std::make_shared<gui::label>();
         music_stamp->set_position({240, 8});
         music_stamp->set_font("LiberationSans-Regular");
-        music_stamp->set_size(renderer, 8);
-        music_stamp->set_text(renderer, "M to toggle music");
+        music_stamp->set_size(*renderer, 8);
+        music_stamp->set_text(*renderer, "M to toggle music");
         music_stamp->set_color({1, 1, 1, 1});
         music_stamp->show();
         root_widget->add_child(music_stamp);
@@ -189,7 +320,7 @@ ld42_engine::ld42_engine() {
         root_widget->add_child(panel);
     }
 
-    auto debug_root = std::make_shared<gui::screen>(glm::vec2{320, 240});
+    debug_root = std::make_shared<gui::screen>(glm::vec2{320, 240});
 #ifndef NDEBUG
     debug_root->show();
 #endif
@@ -198,16 +329,27 @@ ld42_engine::ld42_engine() {
     framerate_stamp = std::make_shared<gui::label>();
     framerate_stamp->set_position({-1,-1});
     framerate_stamp->set_font("LiberationSans-Regular");
-    framerate_stamp->set_size(renderer, 12);
-    framerate_stamp->set_text(renderer, "");
+    framerate_stamp->set_size(*renderer, 12);
+    framerate_stamp->set_text(*renderer, "");
     framerate_stamp->set_color({1,0,1,1});
     framerate_stamp->show();
     debug_root->add_child(framerate_stamp);
 
+    ecs_stamp = std::make_shared<gui::label>();
+    ecs_stamp->set_position({-1, 1});
+    ecs_stamp->set_font("LiberationSans-Regular");
+    ecs_stamp->set_size(*renderer, 7);
+    ecs_stamp->set_text(*renderer, "");
+    ecs_stamp->set_color({1,0,1,1});
+    ecs_stamp->show();
+    debug_root->add_child(ecs_stamp);
+
     std::cout << "Finalizing engine..." << std::endl;
 
     prev_time = clock::now();
-    framerate_buffer.reserve(10);
+    tick_accumulator = 0.0;
+    tick_count = 0;
+    frame_count = 0;
 
     fade = 0.0;
     fade_dir = 1.0;
@@ -218,64 +360,221 @@ ld42_engine::ld42_engine() {
 }
 
 ld42_engine::~ld42_engine() {
-    SDL_GL_DeleteContext(glcontext);
-    SDL_DestroyWindow(g_window);
-    SDL_Quit();
+    if (sim_job.valid()) {
+        sim_job.wait();
+    }
+
+    if (!headless) {
+        SDL_GL_DeleteContext(glcontext);
+        SDL_DestroyWindow(g_window);
+        SDL_Quit();
+    }
 }
 
-void ld42_engine::step(const std::function<void(ld42_engine& engine, double delta)>& step_func) {
+void ld42_engine::step(const game_state& state) {
     using namespace std::literals;
 
+    // The previous step's simulation owns the ECS, Lua and the action table until it finishes.
+    if (sim_job.valid()) {
+        auto timer = frame_sections.sim_wait->time();
+        sim_job.get();
+        front_frame = 1 - front_frame;
+    }
+
+    // Nothing on screen can change until there is input, so sleep until some arrives.
+    if (!headless && state.is_static && fade == 1.f && fade_dir > 0 && pacer.can_idle()) {
+        SDL_Event event[2];  // Array is needed to work around stack issue in SDL_PollEvent.
+
+        // With no input there is nothing new to simulate or draw, and the wait is not frame time.
+        if (!pacer.idle(event[0])) {
+            prev_time = clock::now();
+            return;
+        }
+
+        if (!handle_gui_input(event[0])) {
+            handle_game_input(event[0]);
+        }
+
+        // The input is only acted on by a tick, however short the wait was.
+        if (tick_rate > 0.0) {
+            tick_accumulator = std::max(tick_accumulator, 1.0 / tick_rate);
+        }
+    }
+
     const auto now = clock::now();
     const auto delta_time = now - prev_time;
     const auto delta = std::chrono::duration<double>(delta_time).count();
 
     prev_time = now;
-    framerate_buffer.push_back(delta_time);
+    ++frame_count;
 
-    if (framerate_buffer.size() >= 10) {
-        const auto avg_frame_dur = std::accumulate(begin(framerate_buffer), end(framerate_buffer), 0ns) / framerate_buffer.size();
-        const auto framerate = 1.0 / std::chrono::duration<double>(avg_frame_dur).count();
+    if (frame_count > 1) {
+        frame_sections.frame->record(delta_time);
+    }
 
-        framerate_stamp->set_text(renderer, std::to_string(std::lround(framerate)) + "fps");
-        framerate_buffer.clear();
+    if (frame_count % 10 == 0) {
+        update_profiler_stamps();
     }
 
-    SDL_Event event[2];  // Array is needed to work around stack issue in SDL_PollEvent.
-    while (SDL_PollEvent(&event[0])) {
-        if (handle_gui_input(event[0])) break;
-        if (handle_game_input(event[0])) break;
+    // Work queued for the main thread by tasks on the pool.
+    jobs->run_main_tasks();
+
+    if (!headless) {
+        auto timer = frame_sections.input->time();
+        SDL_Event event[2];  // Array is needed to work around stack issue in SDL_PollEvent.
+        while (SDL_PollEvent(&event[0])) {
+            if (handle_gui_input(event[0])) break;
+            if (handle_game_input(event[0])) break;
+        }
     }
 
-    // Input
-    {
-        const Uint8* keys = SDL_GetKeyboardState(nullptr);
+    const auto now_ticks = headless ? Uint32{0} : SDL_GetTicks();
 
-        update_input(delta, "left", keys[SDL_SCANCODE_LEFT]);
-        update_input(delta, "right", keys[SDL_SCANCODE_RIGHT]);
-        update_input(delta, "up", keys[SDL_SCANCODE_UP]);
-        update_input(delta, "down", keys[SDL_SCANCODE_DOWN]);
-        update_input(delta, "shoot", keys[SDL_SCANCODE_SPACE]);
-        update_input(delta, "rotate_cw", keys[SDL_SCANCODE_X] | keys[SDL_SCANCODE_F] | keys[SDL_SCANCODE_SPACE]);
-        update_input(delta, "rotate_ccw", keys[SDL_SCANCODE_Z] | keys[SDL_SCANCODE_W] | keys[SDL_SCANCODE_Y] | keys[SDL_SCANCODE_Q]);
-        update_input(delta, "restart", keys[SDL_SCANCODE_R]);
-        update_input(delta, "music", keys[SDL_SCANCODE_M]);
+    if (pipelined) {
+        // Simulate the next frame on the pool while this one is presented.
+        auto& back = frames[1 - front_frame];
+        sim_job = jobs->async([this, &state, delta, now_ticks, &back] {
+            simulate(state, delta, now_ticks, back);
+        });
+    } else {
+        simulate(state, delta, now_ticks, frames[front_frame]);
     }
 
-    // Music
-    {
-        if (input_table["music_pressed"]) {
-            toggle_music("bgm");
+    if (!headless) {
+        present(frames[front_frame]);
+    }
+
+    // Pool time spent running tasks this frame, summed over all workers.
+    if (jobs->get_worker_count() > 0) {
+        frame_sections.jobs->record(jobs->take_busy_time());
+    }
+
+    if (!headless) {
+        pacer.limit(now);
+    }
+}
+
+void ld42_engine::simulate(const game_state& state, double delta, Uint32 now_ticks, frame_data& frame) {
+    // Input events are timestamped in SDL ticks, each simulation tick consumes the events
+    // that happened before the point in time it simulates up to.
+    auto tick = [&](double tick_delta, double time_after) {
+        // Input
+        {
+            auto timer = frame_sections.actions->time();
+            const auto deadline = now_ticks - Uint32(std::max(time_after, 0.0) * 1000.0);
+            actions.update(tick_delta, deadline);
+        }
+
+        // Music
+        {
+            if (actions[input::action::music].pressed) {
+                toggle_music("bgm");
+            }
+        }
+
+        // Fade
+        {
+            fade = std::clamp(float(fade + tick_delta * fade_dir), 0.f, 1.f);
         }
+
+        state.update(*this, tick_delta);
+
+        // Structural changes queued by systems during the tick.
+        {
+            auto timer = frame_sections.flush->time();
+            entities.flush_deferred();
+        }
+
+        // No script handler is running between ticks, so scripts can be rerun safely.
+        resources.apply_script_reloads();
+
+        if (pending_world_file) {
+            auto path = std::move(*pending_world_file);
+            pending_world_file.reset();
+            load_world_file(path);
+        }
+
+        // Undo some of the tick's churn, one fragmented component set at a time.
+        if (compact_each_tick) {
+            auto timer = frame_sections.compact->time();
+            entities.compact_step();
+        }
+
+        entities.advance_change_tick();
+        ++tick_count;
+    };
+
+    // Simulation
+    //
+    // With a positive tick rate the simulation advances in fixed steps, and the scene is
+    // rendered between the last two ticks. A tick rate of 0 steps once per frame instead.
+    // Headless engines run one tick per step, as fast as the caller steps them.
+    auto alpha = 1.0;
+
+    if (headless) {
+        tick(tick_rate > 0.0 ? 1.0 / tick_rate : 1.0 / 60.0, 0.0);
+    } else if (tick_rate > 0.0) {
+        const auto tick_delta = 1.0 / tick_rate;
+
+        tick_accumulator += delta;
+
+        for (auto ticks = 0; tick_accumulator >= tick_delta; ++ticks) {
+            if (ticks == max_ticks_per_frame) {
+                // Too far behind to catch up, drop the backlog instead of spiraling.
+                tick_accumulator = std::fmod(tick_accumulator, tick_delta);
+                break;
+            }
+
+            tick(tick_delta, tick_accumulator - tick_delta);
+            tick_accumulator -= tick_delta;
+        }
+
+        alpha = tick_accumulator / tick_delta;
+    } else {
+        tick(delta, 0.0);
     }
 
-    // Fade
-    {
-        fade = std::clamp(float(fade + delta * fade_dir), 0.f, 1.f);
+    // Snapshot
+    if (!headless) {
+        auto timer = frame_sections.draw->time();
+
+        frame.scene.clear();
+        if (state.draw) {
+            state.draw(*this, alpha, frame.scene);
+        }
+
+        frame.render = state.render;
+        frame.alpha = alpha;
+        frame.fade = fade;
+        frame.score = score;
+        frame.lines_cleared = lines_cleared;
+
+        // Sampled here, the database is only safe to inspect from the simulation.
+        if (tick_count % 10 == 0) {
+            ecs_sample = {entities.size(), entities.memory_report().total_bytes()};
+        }
+        frame.entity_count = ecs_sample.first;
+        frame.ecs_bytes = ecs_sample.second;
+
+        frame.presses.clear();
+        actions.consume_press_times([&](input::action a, Uint32 timestamp) {
+            frame.presses.emplace_back(a, timestamp);
+        });
     }
 
-    score_stamp->set_text(renderer, "Score: " + std::to_string(score));
-    lines_stamp->set_text(renderer, "Lines: " + std::to_string(lines_cleared));
+    gc.step(frame_profiler);
+}
+
+void ld42_engine::present(const frame_data& frame) {
+    using namespace std::literals;
+
+    score_stamp->set_text(*renderer, "Score: " + std::to_string(frame.score));
+    lines_stamp->set_text(*renderer, "Lines: " + std::to_string(frame.lines_cleared));
+
+    if (frame_count % 10 == 0) {
+        ecs_stamp->set_text(*renderer, "ecs " + std::to_string(frame.entity_count) + " entities " +
+            std::to_string((frame.ecs_bytes + 1023) / 1024) + " KiB");
+    }
     root_widget->hide();
 
     // Draw scene
@@ -288,7 +587,11 @@ void ld42_engine::step(const std::function<void(ld42_engine& engine, double delt
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         glViewport(0, 0, 320, 240);
         sushi::set_program(program);
-        step_func(*this, delta);
+        auto timer = frame_sections.render->time();
+        frame.scene.submit(resources.texture_cache, sprite_mesh);
+        if (frame.render) {
+            frame.render(*this, frame.alpha);
+        }
     }
 
     // Draw screen
@@ -308,17 +611,75 @@ void ld42_engine::step(const std::function<void(ld42_engine& engine, double delt
         sushi::set_uniform("normal_mat", glm::transpose(glm::inverse(modelmat)));
         sushi::set_uniform("cam_forward", glm::vec3{0, 0, -1});
         sushi::set_uniform("s_texture", 0);
-        sushi::set_uniform("tint", glm::vec4{fade, fade, fade, 1});
+        sushi::set_uniform("tint", glm::vec4{frame.fade, frame.fade, frame.fade, 1});
         sushi::set_texture(0, framebuffer.color_texs[0]);
         sushi::draw_mesh(framebuffer_mesh);
 
-        renderer.begin();
-        EMBER_DEFER { renderer.end(); };
-        gui_screen.draw(renderer, {0, 0});
+        auto timer = frame_sections.gui->time();
+        renderer->begin();
+        EMBER_DEFER { renderer->end(); };
+        gui_screen.draw(*renderer, {0, 0});
     }
 
-    SDL_GL_SwapWindow(g_window);
-    lua.collect_garbage();
+    {
+        auto timer = frame_sections.swap->time();
+        SDL_GL_SwapWindow(g_window);
+    }
+
+    // Input latency, from the key event to the first frame presented after it was simulated.
+    {
+        const auto presented = SDL_GetTicks();
+        for (const auto& [a, timestamp] : frame.presses) {
+            frame_sections.latency[std::size_t(a)]->record(std::chrono::milliseconds(presented - timestamp));
+        }
+    }
+}
+
+void ld42_engine::update_profiler_stamps() {
+    const auto frame_stats = frame_sections.frame->get_stats();
+
+    if (frame_stats.p50 > 0) {
+        auto text = std::to_string(std::lround(1000.0 / frame_stats.p50)) + "fps";
+
+        // Worker utilization: busy time per frame over the time the pool had available.
+        if (jobs->get_worker_count() > 0) {
+            const auto job_stats = frame_sections.jobs->get_stats();
+            const auto utilization = job_stats.p50 / (frame_stats.p50 * jobs->get_worker_count());
+            text += " jobs " + std::to_string(std::lround(utilization * 100)) + "%";
+        }
+
+        framerate_stamp->set_text(*renderer, text);
+    }
+
+    // One line per section: p50 / p95 / p99 / max, in milliseconds.
+    auto format_ms = [](double ms) {
+        auto str = std::to_string(std::lround(ms * 100));
+        while (str.size() < 3) str.insert(0, "0");
+        str.insert(str.size() - 2, ".");
+        return str;
+    };
+
+    auto sections = frame_profiler.get_sections();
+
+    for (auto i = profiler_stamps.size(); i < sections.size(); ++i) {
+        auto stamp = std::make_shared<gui::label>();
+        stamp->set_position({-1, -14 - 8 * float(i)});
+        stamp->set_font("LiberationSans-Regular");
+        stamp->set_size(*renderer, 7);
+        stamp->set_color({1,0,1,1});
+        stamp->show();
+        debug_root->add_child(stamp);
+        profiler_stamps.push_back(std::move(stamp));
+    }
+
+    for (auto i = std::size_t{0}; i < sections.size(); ++i) {
+        auto stats = sections[i]->get_stats();
+        profiler_stamps[i]->set_text(*renderer, sections[i]->get_name() + " " +
+            format_ms(stats.p50) + " / " +
+            format_ms(stats.p95) + " / " +
+            format_ms(stats.p99) + " / " +
+            format_ms(stats.max));
+    }
 }
 
 bool ld42_engine::handle_game_input(const SDL_Event& event) {
@@ -327,6 +688,10 @@ bool ld42_engine::handle_game_input(const SDL_Event& event) {
             std::cout << "Goodbye!" << std::endl;
             running = false;
             return true;
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+            actions.push_event(event.key);
+            return false;
     }
 
     return false;
@@ -381,47 +746,75 @@ void ld42_engine::toggle_music(const std::string& name) {
 }
 
 ember_database::ent_id ld42_engine::entity_from_json(const nlohmann::json& json) {
-    auto& loader = *resources.environment_cache.get("system/loader");
-    auto data = json.get<std::unordered_map<std::string, nlohmann::json>>();
-    return loader["load_entity"](json).get<ember_database::ent_id>();
+    return world_loader::load_entity(entities, json, script_component_loader());
 }
 
-void ld42_engine::update_input(double delta, const std::string& name, bool keystate) {
-    if (input_table[name].valid()) {
-        auto prev = bool(input_table[name]);
-        auto curr = bool(keystate);
-        input_table[name] = curr;
-        input_table[name + "_pressed"] = curr && !prev;
-        input_table[name + "_released"] = !curr && prev;
-        input_table[name + "_repeat"] = false;
-
-        if (curr) {
-            auto timer = input_table.get_or(name + "_repeat_timer", 0.0);
-            timer -= delta;
-            if (timer <= 0.0) {
-                timer += 0.1;
-                input_table[name + "_repeat"] = true;
-            }
-            input_table[name + "_repeat_timer"] = timer;
-        } else {
-            input_table[name + "_repeat_timer"] = 0.0;
+ember_database::ent_id ld42_engine::spawn_prefab(const std::string& name) {
+    return resources.prefab_cache.get(name)->instantiate(entities, script_component_loader());
+}
+
+ember_database::ent_id ld42_engine::spawn_prefab(const std::string& name, const nlohmann::json& overrides) {
+    return resources.prefab_cache.get(name)->instantiate(entities, overrides, script_component_loader());
+}
+
+void ld42_engine::clear_world() {
+    entities.clear();
+}
+
+world_loader::fallback ld42_engine::script_component_loader() {
+    // Only components without a native entry, such as script-defined ones, go through Lua.
+    return [this, loader = std::shared_ptr<sol::environment>{}](ember_database::ent_id eid, const std::string& name, const nlohmann::json& value) mutable {
+        if (!loader) {
+            loader = resources.environment_cache.get("system/loader");
         }
+        (*loader)["load_component"](eid, name, value);
+    };
+}
+
+void ld42_engine::load_world(const nlohmann::json& json) {
+    clear_world();
+    auto unknown = script_component_loader();
+    for (const auto& data : json) {
+        world_loader::load_entity(entities, data, unknown);
+    }
+    entities.compact();
+}
+
+void ld42_engine::load_world_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open world file: " + path);
+    }
+    clear_world();
+
+    // Files written by save_world_file start with the binary magic, anything else is JSON.
+    auto magic = std::array<char, 4>{};
+    file.read(magic.data(), magic.size());
+    auto count = std::size_t{0};
+    if (file && magic == binary::world_magic) {
+        file.seekg(0, std::ios::end);
+        auto bytes = std::vector<std::byte>(std::size_t(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+        count = binary::load_world(entities, bytes, component::all_components{});
     } else {
-        input_table[name] = bool(keystate);
-        input_table[name + "_pressed"] = bool(keystate);
-        input_table[name + "_released"] = false;
-        input_table[name + "_repeat"] = false;
-        input_table[name + "_repeat_timer"] = 0.0;
+        file.clear();
+        file.seekg(0);
+        count = world_loader::load_world(entities, file, script_component_loader());
     }
+
+    std::cout << "Loaded " << count << " entities from " << path << std::endl;
+    entities.compact();
 }
 
-void ld42_engine::load_world(const nlohmann::json& json) {
-    entities.visit([&](ember_database::ent_id eid) {
-        entities.destroy_entity(eid);
-    });
-    auto& loader = *resources.environment_cache.get("system/loader");
-    auto data = json.get<std::vector<std::unordered_map<std::string, nlohmann::json>>>();
-    loader["load_world"](data);
+void ld42_engine::save_world_file(const std::string& path) {
+    auto bytes = binary::save_world(entities, component::all_components{});
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open world file: " + path);
+    }
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    std::cout << "Saved " << bytes.size() << " bytes to " << path << std::endl;
 }
 
 double ld42_engine::get_tick_delay() {
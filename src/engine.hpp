@@ -9,6 +9,15 @@
 #include "sdl.hpp"
 #include "gui.hpp"
 #include "sushi_renderer.hpp"
+#include "null_renderer.hpp"
+#include "profiler.hpp"
+#include "gc_policy.hpp"
+#include "broadphase.hpp"
+#include "input.hpp"
+#include "frame_pacer.hpp"
+#include "job_system.hpp"
+#include "draw_list.hpp"
+#include "world_loader.hpp"
 
 #include <sushi/framebuffer.hpp>
 #include <sushi/mesh.hpp>
@@ -21,17 +30,47 @@
 #include <vector>
 #include <string>
 #include <random>
+#include <memory>
+#include <array>
+#include <cstdint>
+#include <future>
+#include <optional>
+
+class ld42_engine;
+
+struct game_state {
+    std::function<void(ld42_engine& engine, double delta)> update;
+    std::function<void(ld42_engine& engine, double alpha)> render;
+    bool is_static = false;  // Renders the same frame until input arrives, allowing the engine to idle.
+    std::function<void(ld42_engine& engine, double alpha, draw_list& scene)> draw;  // Fills the scene, may run off the main thread.
+};
 
 class ld42_engine {
 public:
-    ld42_engine();
+    ld42_engine(bool headless = false);
     ld42_engine(const ld42_engine&) = delete;
     ld42_engine(ld42_engine&&) = delete;
     ld42_engine& operator=(const ld42_engine&) = delete;
     ld42_engine& operator=(ld42_engine&&) = delete;
     ~ld42_engine();
 
-    void step(const std::function<void(ld42_engine& engine, double delta)>& step_func);
+    // Everything needed to present one simulated frame, snapshotted so it can be presented while the next one simulates.
+    struct frame_data {
+        draw_list scene;
+        std::function<void(ld42_engine& engine, double alpha)> render;
+        double alpha = 1.0;
+        float fade = 0.f;
+        int score = 0;
+        int lines_cleared = 0;
+        std::size_t entity_count = 0;
+        std::size_t ecs_bytes = 0;
+        std::vector<std::pair<input::action, Uint32>> presses;
+    };
+
+    // When pipelined, the state is still being simulated after this returns, so it must outlive the next step.
+    void step(const game_state& state);
+    void simulate(const game_state& state, double delta, Uint32 now_ticks, frame_data& frame);
+    void present(const frame_data& frame);
 
     bool handle_game_input(const SDL_Event& event);
     bool handle_gui_input(SDL_Event& event);
@@ -40,16 +79,24 @@ public:
     void play_music(const std::string& name);
     void toggle_music(const std::string& name);
     ember_database::ent_id entity_from_json(const nlohmann::json& json);
-
-    void update_input(double delta, const std::string& name, bool keystate);
+    ember_database::ent_id spawn_prefab(const std::string& name);
+    ember_database::ent_id spawn_prefab(const std::string& name, const nlohmann::json& overrides);
 
     void load_world(const nlohmann::json& json);
+    void load_world_file(const std::string& path);
+    void save_world_file(const std::string& path);
+
+    void clear_world();
+    world_loader::fallback script_component_loader();
+
+    void update_profiler_stamps();
 
     double get_tick_delay();
 
     using clock = std::chrono::steady_clock;
 
     bool running;
+    bool headless;
     ember_database entities;
     sol::state lua;
     SoLoud::Soloud soloud;
@@ -65,15 +112,50 @@ public:
     sushi::unique_program program;
     sushi::unique_program program_msdf;
     sushi::static_mesh sprite_mesh;
-    sol::table input_table;
+    input::action_table actions;
     clock::time_point prev_time;
-    std::vector<std::chrono::nanoseconds> framerate_buffer;
-    sushi_renderer renderer;
+    double tick_rate;
+    int max_ticks_per_frame;
+    double tick_accumulator;
+    std::uint64_t tick_count;
+    std::uint64_t frame_count;
+    std::pair<std::size_t, std::size_t> ecs_sample;  // Entity count and bytes, owned by the simulation.
+    profiler frame_profiler;
+    struct {
+        profiler::section* sim_wait;
+        profiler::section* frame;
+        profiler::section* input;
+        profiler::section* jobs;
+        profiler::section* actions;
+        profiler::section* flush;
+        profiler::section* compact;
+        profiler::section* draw;
+        profiler::section* render;
+        profiler::section* gui;
+        profiler::section* swap;
+        std::array<profiler::section*, input::action_count> latency;
+    } frame_sections;  // Looked up once, so recording skips the profiler's name lookup.
+    gc_policy gc;
+    broadphase spatial;
+    std::vector<ember_database::ent_id> query_results;
+    frame_pacer pacer;
+    std::unique_ptr<job_system> jobs;
+    bool pipelined;
+    bool compact_each_tick;
+    bool batch_collisions;
+    std::optional<std::string> pending_world_file;
+    std::array<frame_data, 2> frames;
+    std::size_t front_frame;
+    std::future<void> sim_job;
+    std::unique_ptr<gui::render_context> renderer;
     gui::screen gui_screen;
     std::shared_ptr<gui::screen> root_widget;
     std::shared_ptr<gui::label> score_stamp;
     std::shared_ptr<gui::label> lines_stamp;
+    std::shared_ptr<gui::screen> debug_root;
     std::shared_ptr<gui::label> framerate_stamp;
+    std::shared_ptr<gui::label> ecs_stamp;
+    std::vector<std::shared_ptr<gui::label>> profiler_stamps;
     double fade;
     double fade_dir;
     std::mt19937 rng;
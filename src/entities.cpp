@@ -2,52 +2,319 @@
 
 #include "components.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
 
 ember_database::ent_id ember_database::create_entity() {
     return create_entity(next_id++);
 }
 
 ember_database::ent_id ember_database::create_entity(ember_database::net_id id) {
-    auto iter = netid_to_entid.find(id);
+    check_not_parallel();
 
-    if (iter != netid_to_entid.end()) {
+    if (auto eid = find_live_entity(id)) {
         std::clog << "Warning: Entity " << id << " created twice!" << std::endl;
-        return iter->second;
+        return *eid;
     }
 
+    // Later ids must not collide with ones given by the caller, such as a loaded world's.
+    next_id = std::max(next_id, id + 1);
+
     auto ent = database::create_entity();
     database::create_component(ent, component::net_id{id});
-    netid_to_entid[id] = ent;
+    register_net_id(id, ent);
+    update_queries(ent, ginseng::_detail::get_type_guid<component::net_id>());
 
     return ent;
 }
 
+void ember_database::register_net_id(ember_database::net_id id, ember_database::ent_id eid) {
+    if (eid.get_index() >= generations.size()) {
+        generations.resize(eid.get_index() + 1, 1);
+    }
+
+    netid_to_entid.erase(id);
+    netid_to_entid.insert(id, {eid, generations[eid.get_index()]});
+}
+
+void ember_database::enable_archetypes(bool enabled) {
+    use_archetypes = enabled;
+}
+
+void ember_database::destroy_entity(ember_database::ent_id eid) {
+    check_not_parallel();
+
+    if (has_component<component::net_id>(eid)) {
+        auto id = get_component<component::net_id>(eid).id;
+        auto entry = netid_to_entid.find(id);
+        if (entry && entry->eid.get_index() == eid.get_index()) {
+            netid_to_entid.erase(id);
+        }
+    }
+
+    if (eid.get_index() < generations.size()) {
+        ++generations[eid.get_index()];
+    }
+
+    for (auto& [type, q] : queries) {
+        q->remove(eid);
+    }
+
+    if (chunked.contains(eid)) {
+        chunked.erase(eid);
+    }
+
+    database::destroy_entity(eid);
+}
+
 void ember_database::destroy_entity(ember_database::net_id id) {
-    auto iter = netid_to_entid.find(id);
+    auto eid = find_live_entity(id);
 
-    if (iter == netid_to_entid.end()) {
+    if (!eid) {
         std::clog << "Warning: Attempted to erase unknown entity " << id << "!" << std::endl;
         return;
     }
 
-    database::destroy_entity(iter->second);
-    netid_to_entid.erase(iter);
+    destroy_entity(*eid);
 }
 
 ember_database::ent_id ember_database::get_entity(ember_database::net_id id) {
-    return netid_to_entid.at(id);
+    if (auto eid = find_live_entity(id)) {
+        return *eid;
+    }
+
+    throw std::out_of_range("Unknown entity " + std::to_string(id) + ".");
 }
 
 ember_database::ent_id ember_database::get_or_create_entity(ember_database::net_id id) {
-    auto iter = netid_to_entid.find(id);
-    if (iter == netid_to_entid.end()) {
-        return create_entity(id);
-    } else {
-        return iter->second;
+    if (auto eid = find_live_entity(id)) {
+        return *eid;
+    }
+
+    return create_entity(id);
+}
+
+std::optional<ember_database::ent_id> ember_database::find_entity(ember_database::net_id id) {
+    return find_live_entity(id);
+}
+
+ember_database::net_id ember_database::defer_create_entity() {
+    std::lock_guard<std::mutex> lock(deferred_mutex);
+    auto id = next_id++;
+    deferred.push_back([this, id] {
+        create_entity(id);
+    });
+    return id;
+}
+
+void ember_database::defer_destroy_entity(ember_database::ent_id eid) {
+    defer_destroy_entity(get_net_id(eid));
+}
+
+void ember_database::defer_destroy_entity(ember_database::net_id id) {
+    std::lock_guard<std::mutex> lock(deferred_mutex);
+    deferred.push_back([this, id] {
+        // Entities can be queued for destruction more than once, only the first one counts.
+        if (auto eid = find_live_entity(id)) {
+            destroy_entity(*eid);
+        }
+    });
+}
+
+void ember_database::check_not_parallel() const {
+    if (parallel_visits > 0) {
+        throw std::logic_error("Structural change during a parallel visit, use the deferred functions instead.");
+    }
+}
+
+void ember_database::flush_deferred() {
+    check_not_parallel();
+
+    for (auto& command : deferred) {
+        command();
+    }
+    deferred.clear();
+}
+
+void ember_database::clear() {
+    check_not_parallel();
+
+    {
+        std::lock_guard<std::mutex> lock(deferred_mutex);
+        deferred.clear();
+    }
+
+    destroy_all_entities();
+}
+
+namespace {
+
+template <typename... Coms>
+std::unordered_map<ginseng::_detail::type_guid, std::string> get_component_names(utility::type_list<Coms...>) {
+    return {{ginseng::_detail::get_type_guid<Coms>(), meta::getName<Coms>()}...};
+}
+
+} //namespace
+
+ecs_memory_report ember_database::memory_report() {
+    static const auto names = [] {
+        auto names = get_component_names(component::all_components{});
+        names[ginseng::_detail::get_type_guid<component::net_id>()] = meta::getName<component::net_id>();
+        names[ginseng::_detail::get_type_guid<ginseng::tag<chunked_entity>>()] = "chunked_entity";
+        return names;
+    }();
+
+    ecs_memory_report report;
+
+    auto stats = database::get_stats();
+    report.entities = stats.entities - stats.free_entities;
+    report.free_entities = stats.free_entities;
+    report.entity_bytes = stats.entity_bytes;
+
+    for (const auto& set : stats.component_sets) {
+        ecs_memory_report::component_set entry;
+        auto name = names.find(set.guid);
+        entry.name = name != names.end() ? name->second : "#" + std::to_string(set.guid);
+        entry.live = set.live;
+        entry.free_slots = set.slots - set.live;
+        entry.buckets = set.buckets;
+        entry.capacity = set.capacity;
+        entry.entid_to_comid_size = set.entid_to_comid_size;
+        entry.comid_to_entid_size = set.comid_to_entid_size;
+        entry.bytes = set.bucket_bytes + set.index_bytes;
+        report.component_sets.push_back(std::move(entry));
+    }
+
+    report.archetype_store = chunked.get_memory_stats();
+
+    report.net_ids = netid_to_entid.size();
+    report.net_id_pages = netid_to_entid.page_count();
+    report.net_id_bytes = netid_to_entid.memory_bytes() + generations.capacity() * sizeof(std::uint32_t);
+
+    for (const auto& [type, q] : queries) {
+        report.query_bytes += q->memory_bytes();
+    }
+
+    for (const auto& stamps : change_stamps) {
+        if (stamps) {
+            report.change_stamp_bytes += stamps->capacity() * sizeof(std::uint64_t);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(deferred_mutex);
+        report.deferred_commands = deferred.size();
+    }
+
+    return report;
+}
+
+void ember_database::compact() {
+    check_not_parallel();
+
+    database::compact();
+
+    for (auto& [type, q] : queries) {
+        q->sort();
+    }
+}
+
+bool ember_database::compact_step() {
+    check_not_parallel();
+
+    return database::compact_step();
+}
+
+std::size_t ecs_memory_report::total_bytes() const {
+    auto total = entity_bytes + archetype_store.bytes + net_id_bytes + query_bytes + change_stamp_bytes;
+    for (const auto& set : component_sets) {
+        total += set.bytes;
+    }
+    return total;
+}
+
+std::string ecs_memory_report::to_string() const {
+    auto kib = [](std::size_t bytes) {
+        return std::to_string((bytes + 1023) / 1024) + " KiB";
+    };
+
+    auto str = std::string{};
+    str += "ECS memory: " + kib(total_bytes()) + "\n";
+    str += "  entities: " + std::to_string(entities) + " live, " + std::to_string(free_entities) + " free, " + kib(entity_bytes) + "\n";
+
+    for (const auto& set : component_sets) {
+        str += "  " + set.name + ": " +
+            std::to_string(set.live) + " live, " +
+            std::to_string(set.free_slots) + " free, " +
+            std::to_string(set.buckets) + " buckets (" + std::to_string(set.capacity) + " slots), " +
+            "entid_to_comid " + std::to_string(set.entid_to_comid_size) + ", " +
+            "comid_to_entid " + std::to_string(set.comid_to_entid_size) + ", " +
+            kib(set.bytes) + "\n";
+    }
+
+    str += "  archetypes: " + std::to_string(archetype_store.archetypes) + ", " +
+        std::to_string(archetype_store.rows) + " rows in " +
+        std::to_string(archetype_store.chunks) + " chunks (" + std::to_string(archetype_store.capacity) + " rows), " +
+        kib(archetype_store.bytes) + "\n";
+    str += "  net_ids: " + std::to_string(net_ids) + " in " + std::to_string(net_id_pages) + " pages, " + kib(net_id_bytes) + "\n";
+    str += "  queries: " + kib(query_bytes) + "\n";
+    str += "  change stamps: " + kib(change_stamp_bytes) + "\n";
+    str += "  deferred commands: " + std::to_string(deferred_commands) + "\n";
+
+    return str;
+}
+
+void ember_database::update_queries(ember_database::ent_id eid, ginseng::_detail::type_guid guid) {
+    for (auto& [type, q] : queries) {
+        if (q->watches(guid)) {
+            q->update(*this, eid);
+        }
+    }
+}
+
+void ember_database::update_queries(ember_database::ent_id eid) {
+    for (auto& [type, q] : queries) {
+        q->update(*this, eid);
+    }
+}
+
+void ember_database::destroy_all_entities() {
+    std::vector<ent_id> eids;
+    visit([&](ent_id eid) {
+        eids.push_back(eid);
+    });
+
+    for (auto eid : eids) {
+        destroy_entity(eid);
     }
 }
 
+std::uint64_t ember_database::get_change_tick() const {
+    return change_tick;
+}
+
+void ember_database::advance_change_tick() {
+    ++change_tick;
+}
+
+ember_database::net_id ember_database::get_net_id(ember_database::ent_id eid) {
+    return get_component<component::net_id>(eid).id;
+}
+
+auto ember_database::find_live_entity(ember_database::net_id id) -> std::optional<ent_id> {
+    auto entry = netid_to_entid.find(id);
+
+    // The generation no longer matches once the entity has been destroyed, even if its index was reused.
+    if (!entry || generations[entry->eid.get_index()] != entry->generation) {
+        return std::nullopt;
+    }
+
+    return entry->eid;
+}
+
 namespace scripting {
 
 template <>
@@ -60,9 +327,14 @@ void register_type<ember_database>(sol::table& lua) {
             sol::resolve<ember_database::ent_id()>(&ember_database::create_entity),
             sol::resolve<ember_database::ent_id(ember_database::net_id)>(&ember_database::create_entity)),
         "destroy_entity", sol::resolve<void(ember_database::ent_id)>(&ember_database::destroy_entity),
+        "defer_create_entity", &ember_database::defer_create_entity,
+        "defer_destroy_entity", sol::resolve<void(ember_database::ent_id)>(&ember_database::defer_destroy_entity),
         "get_entity", &ember_database::get_entity,
         "get_or_create_entity", &ember_database::get_or_create_entity,
         "size", &ember_database::size,
+        "memory_report", [](ember_database& db) {
+            return db.memory_report().to_string();
+        },
         "create_component", [](ember_database& db, ember_database::ent_id eid, sol::userdata com){
             return com["_create_component"](db, eid, com);
         },
@@ -4,15 +4,179 @@
 #include "scripting.hpp"
 #include "json.hpp"
 #include "utility.hpp"
+#include "paged_index.hpp"
+#include "archetype_storage.hpp"
+#include "snapshot.hpp"
 
 #include <ginseng/ginseng.hpp>
 
 #include <Meta.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeindex>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace component {
+struct net_id;
+} //namespace component
+
+// Memory used by an ember_database, see ember_database::memory_report.
+struct ecs_memory_report {
+    // One of ginseng's component sets. Free slots are holes left by destroyed components.
+    struct component_set {
+        std::string name;
+        std::size_t live = 0;
+        std::size_t free_slots = 0;
+        std::size_t buckets = 0;
+        std::size_t capacity = 0;
+        std::size_t entid_to_comid_size = 0;
+        std::size_t comid_to_entid_size = 0;
+        std::size_t bytes = 0;
+    };
+
+    std::size_t entities = 0;
+    std::size_t free_entities = 0;
+    std::size_t entity_bytes = 0;
+    std::vector<component_set> component_sets;
+    archetypes::archetype_store::memory_stats archetype_store;
+    std::size_t net_ids = 0;
+    std::size_t net_id_pages = 0;
+    std::size_t net_id_bytes = 0;
+    std::size_t query_bytes = 0;
+    std::size_t change_stamp_bytes = 0;
+    std::size_t deferred_commands = 0;
+
+    std::size_t total_bytes() const;
+
+    std::string to_string() const;
+};
 
 class ember_database : public ginseng::database {
+    // Marks entities whose components live in the archetype store.
+    struct chunked_entity {};
+
+    // Delays lookup of a type until a template is instantiated, for types that are incomplete here.
+    template <typename T, typename... Ts>
+    struct dependent {
+        using type = T;
+    };
+
+    // Dense list of the entities that have all of a query's component types.
+    class query_base {
+    public:
+        virtual ~query_base() = default;
+
+        virtual bool watches(ginseng::_detail::type_guid guid) const = 0;
+
+        virtual void update(ember_database& db, ent_id eid) = 0;
+
+        const std::vector<ent_id>& get_members() const {
+            return members;
+        }
+
+        std::size_t memory_bytes() const {
+            return members.capacity() * sizeof(ent_id) + slots.capacity() * sizeof(std::uint32_t);
+        }
+
+        void insert(ent_id eid) {
+            auto index = eid.get_index();
+            if (index >= slots.size()) {
+                slots.resize(index + 1, none);
+            }
+            if (slots[index] == none) {
+                slots[index] = std::uint32_t(members.size());
+                members.push_back(eid);
+            }
+        }
+
+        // Orders the members by entity, so visits look components up in storage order.
+        void sort() {
+            std::sort(begin(members), end(members), [](ent_id a, ent_id b) {
+                return a.get_index() < b.get_index();
+            });
+            for (auto i = std::size_t{0}; i < members.size(); ++i) {
+                slots[members[i].get_index()] = std::uint32_t(i);
+            }
+        }
+
+        void remove(ent_id eid) {
+            auto index = eid.get_index();
+            if (index >= slots.size() || slots[index] == none) {
+                return;
+            }
+            auto slot = slots[index];
+            members[slot] = members.back();
+            slots[members[slot].get_index()] = slot;
+            members.pop_back();
+            slots[index] = none;
+        }
+
+    private:
+        static constexpr std::uint32_t none = ~std::uint32_t{0};
+
+        std::vector<ent_id> members;
+        std::vector<std::uint32_t> slots;  // Per ent_id index, position in members.
+    };
+
+    template <typename... Coms>
+    class query final : public query_base {
+    public:
+        bool watches(ginseng::_detail::type_guid guid) const override {
+            return ((guid == ginseng::_detail::get_type_guid<Coms>()) || ...);
+        }
+
+        void update(ember_database& db, ent_id eid) override {
+            if ((db.has_component<Coms>(eid) && ...)) {
+                insert(eid);
+            } else {
+                remove(eid);
+            }
+        }
+    };
+
+    // Fetches a visitor parameter of a query visit.
+    template <typename P, typename Category = archetypes::_detail::category_t<std::decay_t<P>>>
+    struct query_param {
+        static decltype(auto) get(ember_database& db, ent_id eid) {
+            return db.get_component<std::decay_t<P>>(eid);
+        }
+    };
+
+    template <typename P>
+    struct query_param<P, ginseng::_detail::component_tags::optional> {
+        static std::decay_t<P> get(ember_database& db, ent_id eid) {
+            using inner = archetypes::_detail::component_t<std::decay_t<P>>;
+            if constexpr (archetypes::_detail::is_tag<inner>::value) {
+                return std::decay_t<P>(db.has_component<inner>(eid));
+            } else if (db.has_component<inner>(eid)) {
+                return std::decay_t<P>(db.get_component<inner>(eid));
+            } else {
+                return {};
+            }
+        }
+    };
+
+    template <typename P>
+    struct query_param<P, ginseng::_detail::component_tags::eid> {
+        static ent_id get(ember_database& db, ent_id eid) {
+            return eid;
+        }
+    };
+
     template <typename... Coms>
     struct entity_serializer {
         static nlohmann::json serialize(ember_database& db, ent_id eid) {
@@ -35,26 +199,625 @@ class ember_database : public ginseng::database {
 public:
     using net_id = std::int64_t;
 
-    using ginseng::database::destroy_entity;
-
     ent_id create_entity();
 
     ent_id create_entity(net_id id);
 
+    void destroy_entity(ent_id eid);
+
     void destroy_entity(net_id id);
 
     ent_id get_entity(net_id id);
 
     ent_id get_or_create_entity(net_id id);
 
+    // The entity created with this net_id, unless it has been destroyed since.
+    std::optional<ent_id> find_entity(net_id id);
+
     template <typename... Coms>
     nlohmann::json serialize_entity(ent_id eid) {
         return entity_serializer<Coms...>::serialize(*this, eid);
     }
 
+    // Memory used by entities, component storage and the database's own indices.
+    ecs_memory_report memory_report();
+
+    // Compaction.
+    //
+    // Churn leaves holes in ginseng's component sets, so visits skip free slots and jump around
+    // memory. Compaction moves live components back together in entity order. ent_ids and net_ids
+    // are unchanged, and archetype chunks are always dense so they are left alone.
+
+    void compact();
+
+    // Does a bounded slice of work on one fragmented component set, cheap enough to run every tick.
+    // Moved components are not put in entity order; compact() does that.
+    bool compact_step();
+
+    // Archetype storage.
+    //
+    // With archetype storage enabled, entities created by create_entity_with keep all of their
+    // components in the archetype store, so visits over them stream through contiguous arrays.
+    // Other entities, and all entities when it is disabled, use ginseng's storage.
+    // The component functions and visit below work the same for both kinds of entity.
+
+    void enable_archetypes(bool enabled);
+
+    template <typename... Coms>
+    ent_id create_entity_with(Coms&&... coms) {
+        return create_entity_with_id(next_id++, std::forward<Coms>(coms)...);
+    }
+
+    // Creates `n` entities from copies of the prototype components, under consecutive net_ids
+    // starting at the returned one. If given, `init(i, coms...)` adjusts the i-th entity's copies
+    // before they are stored. The component types and archetype are resolved once for the batch.
+    template <typename Init, typename... Coms,
+              std::enable_if_t<std::is_invocable_v<Init&, std::size_t, Coms&...>, int> = 0>
+    net_id create_entities(std::size_t n, Init&& init, const Coms&... prototype) {
+        using net_id_com = typename dependent<component::net_id, Coms...>::type;
+
+        check_not_parallel();
+
+        auto first = next_id;
+        next_id += net_id(n);
+
+        auto arch = use_archetypes ? &chunked.get_archetype_of<net_id_com, Coms...>() : nullptr;
+
+        // Grow the entity table and component sets once, not bucket by bucket inside the loop.
+        database::reserve_entities(n);
+        if (generations.size() + n > generations.capacity()) {
+            generations.reserve(std::max(generations.size() + n, generations.capacity() * 2));
+        }
+        if (arch) {
+            database::reserve_components<ginseng::tag<chunked_entity>>(n);
+        } else {
+            database::reserve_components<net_id_com>(n);
+            (database::reserve_components<Coms>(n), ...);
+        }
+
+        for (auto i = std::size_t{0}; i < n; ++i) {
+            auto coms = std::make_tuple(prototype...);
+            auto id = first + net_id(i);
+            auto eid = database::create_entity();
+
+            std::apply([&](Coms&... c) {
+                init(i, c...);
+                if (arch) {
+                    database::create_component(eid, ginseng::tag<chunked_entity>{});
+                    chunked.insert_into(*arch, eid, net_id_com{id}, std::move(c)...);
+                } else {
+                    database::create_component(eid, net_id_com{id});
+                    (database::create_component(eid, std::move(c)), ...);
+                }
+            }, coms);
+
+            register_net_id(id, eid);
+            (stamp<Coms>(eid), ...);
+            update_queries(eid);
+        }
+
+        return first;
+    }
+
+    template <typename Com, typename... Coms,
+              std::enable_if_t<!std::is_invocable_v<const Com&, std::size_t, Coms&...>, int> = 0>
+    net_id create_entities(std::size_t n, const Com& com, const Coms&... coms) {
+        return create_entities(n, [](std::size_t, Com&, Coms&...) {}, com, coms...);
+    }
+
+    template <typename T>
+    com_id create_component(ent_id eid, T&& com) {
+        check_not_parallel();
+        stamp<std::decay_t<T>>(eid);
+
+        auto cid = com_id{};
+        if (chunked.contains(eid)) {
+            chunked.assign(eid, std::forward<T>(com));
+        } else {
+            cid = database::create_component(eid, std::forward<T>(com));
+        }
+
+        update_queries(eid, ginseng::_detail::get_type_guid<std::decay_t<T>>());
+
+        return cid;
+    }
+
+    template <typename Com>
+    void destroy_component(ent_id eid) {
+        check_not_parallel();
+        if (chunked.contains(eid)) {
+            chunked.remove<Com>(eid);
+        } else {
+            database::destroy_component<Com>(eid);
+        }
+
+        update_queries(eid, ginseng::_detail::get_type_guid<Com>());
+    }
+
+    template <typename Com>
+    Com& get_component(ent_id eid) {
+        if (chunked.contains(eid)) {
+            return *chunked.find<Com>(eid);
+        }
+        return database::get_component<Com>(eid);
+    }
+
+    template <typename Com>
+    bool has_component(ent_id eid) {
+        if (chunked.contains(eid)) {
+            return chunked.has<Com>(eid);
+        }
+        return database::has_component<Com>(eid);
+    }
+
+    template <typename Visitor>
+    void visit(Visitor&& visitor) {
+        stamp_writes(visitor, archetypes::_detail::visitor_params_t<Visitor>{}, [&](auto& v) {
+            visit_storages(v);
+        });
+    }
+
+    // Visits on the pool, about `grain` entities per task.
+    //
+    // Each entity is visited by exactly one task, so the visitor may write to the components it is
+    // given. Anything else, such as other entities' components, must only be read, and structural
+    // changes must go through the defer_ functions. Immediate structural changes throw meanwhile.
+    template <typename Visitor>
+    void parallel_visit(job_system& jobs, Visitor&& visitor, std::size_t grain = 1024) {
+        ++parallel_visits;
+        EMBER_DEFER { --parallel_visits; };
+
+        stamp_writes(visitor, archetypes::_detail::visitor_params_t<Visitor>{}, [&](auto& v) {
+            parallel_visit_sparse(jobs, v, grain, archetypes::_detail::visitor_params_t<decltype(v)>{});
+            if (chunked.size() > 0) {
+                chunked.parallel_visit(jobs, v, grain);
+            }
+        });
+    }
+
+    // Persistent queries.
+    //
+    // A query keeps a dense list of the entities that have all of its component types, updated as
+    // components are added and removed, so visiting it costs as much as its matches rather than a
+    // scan of a whole component set. It is built on first use and kept for the database's lifetime.
+    // The visitor may take the query's components, optional components and the ent_id, and must
+    // not make structural changes.
+
+    template <typename... Coms, typename Visitor>
+    void visit_query(Visitor&& visitor) {
+        visit_query_impl(find_query<Coms...>(), visitor, archetypes::_detail::visitor_params_t<Visitor>{});
+    }
+
+    template <typename... Coms>
+    std::size_t query_size() {
+        return find_query<Coms...>().get_members().size();
+    }
+
+    // Change tracking.
+    //
+    // Components of tracked types remember the change tick they were last written on. Creating a
+    // component counts as a write, and so does visiting it through a non-const reference or an
+    // optional. Writes through get_component are not seen, call mark_changed after those.
+    // Destroyed components and entities are not recorded.
+
+    template <typename Com>
+    void track_changes() {
+        auto guid = ginseng::_detail::get_type_guid<Com>();
+        if (guid >= change_stamps.size()) {
+            change_stamps.resize(guid + 1);
+        }
+        if (!change_stamps[guid]) {
+            change_stamps[guid] = std::make_unique<stamp_column>();
+        }
+    }
+
+    // Starts at 1, so that 0 can mean "never written".
+    std::uint64_t get_change_tick() const;
+
+    void advance_change_tick();
+
+    template <typename Com>
+    void mark_changed(ent_id eid) {
+        stamp<Com>(eid);
+    }
+
+    // The tick Com was last written on, or 0 if it is untracked or has not been written.
+    template <typename Com>
+    std::uint64_t get_change_stamp(ent_id eid) {
+        auto stamps = find_stamps<Com>();
+        if (!stamps || eid.get_index() >= stamps->size()) {
+            return 0;
+        }
+        return (*stamps)[eid.get_index()];
+    }
+
+    // Like visit, but skips entities where none of the visitor's tracked components have been
+    // written on or after tick `since`. Consumers keep the get_change_tick() of their previous pass.
+    template <typename Visitor>
+    void visit_changed_since(std::uint64_t since, Visitor&& visitor) {
+        visit_changed_since_impl(since, visitor, archetypes::_detail::visitor_params_t<Visitor>{});
+    }
+
+    // Snapshots.
+    //
+    // A snapshot holds the given component types of every entity, plus net_ids and the next
+    // net_id to hand out, in one buffer. Restoring drops pending deferred commands, destroys all entities
+    // and recreates the snapshotted ones under their original net_ids, though not necessarily their original ent_ids.
+
+    template <typename... Coms>
+    world_snapshot snapshot(utility::type_list<Coms...>) {
+        using net_id_com = typename dependent<component::net_id, Coms...>::type;
+
+        auto snap = world_snapshot{};
+        auto out = snapshots::writer(snap);
+
+        out.write(next_id);
+
+        // Components refer to entities by their position in this table.
+        auto ordinals = std::vector<std::uint32_t>(generations.size());
+        auto count_offset = out.reserve<std::uint32_t>();
+        auto count = std::uint32_t{0};
+        visit([&](ent_id eid, const net_id_com& id) {
+            ordinals[eid.get_index()] = count++;
+            out.write(id.id);
+            out.write(chunked.contains(eid));
+        });
+        out.write_at(count_offset, count);
+
+        (snapshot_components<Coms>(out, ordinals), ...);
+
+        return snap;
+    }
+
+    template <typename... Coms>
+    void restore(const world_snapshot& snap, utility::type_list<Coms...>) {
+        using net_id_com = typename dependent<component::net_id, Coms...>::type;
+
+        clear();
+
+        auto in = snapshots::reader(snap);
+
+        auto snap_next_id = in.read<net_id>();
+
+        auto count = in.read<std::uint32_t>();
+        auto eids = std::vector<ent_id>();
+        eids.reserve(count);
+        for (auto i = std::uint32_t{0}; i < count; ++i) {
+            auto id = in.read<net_id>();
+            if (in.read<bool>() && use_archetypes) {
+                auto eid = database::create_entity();
+                database::create_component(eid, ginseng::tag<chunked_entity>{});
+                chunked.insert(eid, net_id_com{id});
+                register_net_id(id, eid);
+                update_queries(eid);
+                eids.push_back(eid);
+            } else {
+                eids.push_back(create_entity(id));
+            }
+        }
+
+        next_id = snap_next_id;
+
+        (restore_components<Coms>(in, eids), ...);
+    }
+
+    // Deferred structural changes.
+    //
+    // These queue the change instead of applying it, so they can be used while visiting.
+    // Commands refer to entities by net_id, and are applied in order by flush_deferred.
+    // Commands for entities that are gone by then are dropped.
+
+    net_id defer_create_entity();
+
+    void defer_destroy_entity(ent_id eid);
+
+    void defer_destroy_entity(net_id id);
+
+    template <typename... Coms>
+    net_id defer_create_entity_with(Coms... coms) {
+        std::lock_guard<std::mutex> lock(deferred_mutex);
+        auto id = next_id++;
+        deferred.push_back([this, id, coms = std::make_tuple(std::move(coms)...)]() mutable {
+            std::apply([&](auto&... c) { create_entity_with_id(id, std::move(c)...); }, coms);
+        });
+        return id;
+    }
+
+    template <typename Com>
+    void defer_create_component(net_id id, Com com) {
+        std::lock_guard<std::mutex> lock(deferred_mutex);
+        deferred.push_back([this, id, com = std::move(com)]() mutable {
+            if (auto eid = find_live_entity(id)) {
+                create_component(*eid, std::move(com));
+            }
+        });
+    }
+
+    template <typename Com>
+    void defer_create_component(ent_id eid, Com com) {
+        defer_create_component(get_net_id(eid), std::move(com));
+    }
+
+    template <typename Com>
+    void defer_destroy_component(ent_id eid) {
+        auto id = get_net_id(eid);
+        std::lock_guard<std::mutex> lock(deferred_mutex);
+        deferred.push_back([this, id] {
+            auto eid = find_live_entity(id);
+            if (eid && has_component<Com>(*eid)) {
+                destroy_component<Com>(*eid);
+            }
+        });
+    }
+
+    void flush_deferred();
+
+    // Destroys every entity. Queued deferred commands are dropped, since they refer to the old entities.
+    void clear();
+
 private:
+    template <typename... Coms>
+    ent_id create_entity_with_id(net_id id, Coms&&... coms) {
+        check_not_parallel();
+
+        if (!use_archetypes) {
+            auto eid = create_entity(id);
+            (stamp<std::decay_t<Coms>>(eid), ...);
+            (database::create_component(eid, std::forward<Coms>(coms)), ...);
+            update_queries(eid);
+            return eid;
+        }
+
+        if (auto eid = find_live_entity(id)) {
+            std::clog << "Warning: Entity " << id << " created twice!" << std::endl;
+            return *eid;
+        }
+
+        using net_id_com = typename dependent<component::net_id, Coms...>::type;
+
+        auto eid = database::create_entity();
+        database::create_component(eid, ginseng::tag<chunked_entity>{});
+        chunked.insert(eid, net_id_com{id}, std::forward<Coms>(coms)...);
+        register_net_id(id, eid);
+        (stamp<std::decay_t<Coms>>(eid), ...);
+        update_queries(eid);
+
+        return eid;
+    }
+
+    template <typename... Coms>
+    query_base& find_query() {
+        auto& q = queries[std::type_index(typeid(query<Coms...>))];
+
+        if (!q) {
+            q = std::make_unique<query<Coms...>>();
+            visit([&](ent_id eid) {
+                q->update(*this, eid);
+            });
+        }
+
+        return *q;
+    }
+
+    template <typename Visitor, typename... Params>
+    void visit_query_impl(query_base& q, Visitor& visitor, utility::type_list<Params...> param_types) {
+        auto written = find_written_stamps(param_types);
+        auto tick = change_tick;
+
+        for (auto eid : q.get_members()) {
+            visitor(query_param<Params>::get(*this, eid)...);
+            stamp_all(written, eid, tick);
+        }
+    }
+
+    // Re-checks the entity's membership in the queries that involve the given component type.
+    void update_queries(ent_id eid, ginseng::_detail::type_guid guid);
+
+    // Re-checks the entity's membership in every query.
+    void update_queries(ent_id eid);
+
+    template <typename Com>
+    void snapshot_components(snapshots::writer& out, const std::vector<std::uint32_t>& ordinals) {
+        auto count_offset = out.reserve<std::uint32_t>();
+        auto count = std::uint32_t{0};
+        visit([&](ent_id eid, const Com& com) {
+            out.write(ordinals[eid.get_index()]);
+            out.write(com);
+            ++count;
+        });
+        out.write_at(count_offset, count);
+    }
+
+    template <typename Com>
+    void restore_components(snapshots::reader& in, const std::vector<ent_id>& eids) {
+        auto count = in.read<std::uint32_t>();
+        for (auto i = std::uint32_t{0}; i < count; ++i) {
+            auto ordinal = in.read<std::uint32_t>();
+            create_component(eids.at(ordinal), in.read<Com>());
+        }
+    }
+
+    void destroy_all_entities();
+
+    using stamp_column = std::vector<std::uint64_t>;  // Per ent_id index.
+
+    // The tracked component type a visitor parameter can write to, or void.
+    template <typename P, typename Category = archetypes::_detail::category_t<std::decay_t<P>>>
+    struct written_component {
+        using type = void;
+    };
+
+    template <typename T>
+    struct written_component<T&, ginseng::_detail::component_tags::normal> {
+        using type = std::conditional_t<std::is_const_v<T>, void, T>;
+    };
+
+    template <typename P>
+    struct written_component<P, ginseng::_detail::component_tags::optional> {
+        using inner = archetypes::_detail::component_t<std::decay_t<P>>;
+        using type = std::conditional_t<archetypes::_detail::is_tag<inner>::value, void, inner>;
+    };
+
+    // The component type a visitor parameter reads, or void.
+    template <typename P, typename Category = archetypes::_detail::category_t<std::decay_t<P>>>
+    struct read_component {
+        using type = void;
+    };
+
+    template <typename P>
+    struct read_component<P, ginseng::_detail::component_tags::normal> {
+        using type = std::decay_t<P>;
+    };
+
+    template <typename P>
+    struct read_component<P, ginseng::_detail::component_tags::optional> : written_component<P> {};
+
+    template <typename Com>
+    stamp_column* find_stamps() {
+        if constexpr (std::is_void_v<Com>) {
+            return nullptr;
+        } else {
+            auto guid = ginseng::_detail::get_type_guid<Com>();
+            return guid < change_stamps.size() ? change_stamps[guid].get() : nullptr;
+        }
+    }
+
+    template <typename Com>
+    void stamp(ent_id eid) {
+        if (auto stamps = find_stamps<Com>()) {
+            if (eid.get_index() >= stamps->size()) {
+                stamps->resize(eid.get_index() + 1);
+            }
+            (*stamps)[eid.get_index()] = change_tick;
+        }
+    }
+
+    // Stamps of the tracked components a visitor can write to, null for other parameters.
+    // They are sized up front, so parallel visits only write to their own entities' slots.
+    template <typename... Params>
+    std::array<stamp_column*, sizeof...(Params)> find_written_stamps(utility::type_list<Params...>) {
+        auto written = std::array<stamp_column*, sizeof...(Params)>{
+            find_stamps<typename written_component<Params>::type>()...};
+
+        for (auto stamps : written) {
+            if (stamps && stamps->size() < generations.size()) {
+                stamps->resize(generations.size());
+            }
+        }
+
+        return written;
+    }
+
+    template <std::size_t N>
+    static void stamp_all(const std::array<stamp_column*, N>& columns, ent_id eid, std::uint64_t tick) {
+        for (auto stamps : columns) {
+            if (stamps) {
+                (*stamps)[eid.get_index()] = tick;
+            }
+        }
+    }
+
+    template <std::size_t N>
+    static bool any_tracked(const std::array<stamp_column*, N>& columns) {
+        return std::any_of(begin(columns), end(columns), [](stamp_column* s) { return s != nullptr; });
+    }
+
+    // Calls run with the visitor, wrapped to stamp the tracked components it can write to.
+    template <typename Visitor, typename Run, typename... Params>
+    void stamp_writes(Visitor& visitor, utility::type_list<Params...> param_types, Run&& run) {
+        auto written = find_written_stamps(param_types);
+
+        if (!any_tracked(written)) {
+            run(visitor);
+            return;
+        }
+
+        auto stamping = [&, tick = change_tick](ent_id eid, Params... params) {
+            visitor(std::forward<Params>(params)...);
+            stamp_all(written, eid, tick);
+        };
+
+        run(stamping);
+    }
+
+    template <typename Visitor, typename... Params>
+    void visit_changed_since_impl(std::uint64_t since, Visitor& visitor, utility::type_list<Params...> param_types) {
+        auto read = std::array<stamp_column*, sizeof...(Params)>{
+            find_stamps<typename read_component<Params>::type>()...};
+
+        if (!any_tracked(read)) {
+            throw std::logic_error("visit_changed_since needs a tracked component parameter.");
+        }
+
+        auto written = find_written_stamps(param_types);
+
+        // Skipped entities keep their stamps.
+        visit_storages([&, tick = change_tick](ent_id eid, Params... params) {
+            auto index = eid.get_index();
+            auto changed = std::any_of(begin(read), end(read), [&](stamp_column* stamps) {
+                return stamps && index < stamps->size() && (*stamps)[index] >= since;
+            });
+
+            if (changed) {
+                visitor(std::forward<Params>(params)...);
+                stamp_all(written, eid, tick);
+            }
+        });
+    }
+
+    template <typename Visitor>
+    void visit_storages(Visitor&& visitor) {
+        visit_sparse(visitor, archetypes::_detail::visitor_params_t<Visitor>{});
+        if (chunked.size() > 0) {
+            chunked.visit(visitor);
+        }
+    }
+
+    template <typename Visitor, typename... Params>
+    void parallel_visit_sparse(job_system& jobs, Visitor& visitor, std::size_t grain, utility::type_list<Params...>) {
+        auto wrapper = [&](ginseng::deny<ginseng::tag<chunked_entity>>, Params... params) {
+            visitor(std::forward<Params>(params)...);
+        };
+
+        jobs.parallel_for(0, database::visit_extent<decltype(wrapper)>(), grain, [&](std::size_t first, std::size_t last) {
+            database::visit_range(wrapper, first, last);
+        });
+    }
+
+    // Ginseng's visit, skipping entities in the archetype store.
+    template <typename Visitor, typename... Params>
+    void visit_sparse(Visitor& visitor, utility::type_list<Params...>) {
+        database::visit([&](ginseng::deny<ginseng::tag<chunked_entity>>, Params... params) {
+            visitor(std::forward<Params>(params)...);
+        });
+    }
+
+    void register_net_id(net_id id, ent_id eid);
+
+    void check_not_parallel() const;
+
+    net_id get_net_id(ent_id eid);
+
+    // The entity with the given net_id, if it is still alive.
+    std::optional<ent_id> find_live_entity(net_id id);
+
+    // The ent_id a net_id was created with, and that entity's generation at the time.
+    struct net_entry {
+        ent_id eid;
+        std::uint32_t generation = 0;
+    };
+
     net_id next_id = 1;
-    std::unordered_map<net_id, ent_id> netid_to_entid;
+    paged_index<net_entry> netid_to_entid;
+    std::vector<std::uint32_t> generations;  // Per ent_id index, bumped on destroy.
+    std::vector<std::function<void()>> deferred;
+    std::mutex deferred_mutex;
+    std::atomic<int> parallel_visits = 0;
+    std::uint64_t change_tick = 1;
+    std::vector<std::unique_ptr<stamp_column>> change_stamps;  // Per type guid, null if untracked.
+    std::unordered_map<std::type_index, std::unique_ptr<query_base>> queries;
+    bool use_archetypes = false;
+    archetypes::archetype_store chunked;
 };
 
 namespace scripting {
@@ -1,7 +1,9 @@
 #include "font.hpp"
 
+#include "job_system.hpp"
 #include "json.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
@@ -35,75 +37,129 @@ const msdf_font::glyph& msdf_font::get_glyph(int unicode) const {
     auto iter = glyphs.find(unicode);
 
     if (iter == end(glyphs)) {
-        msdfgen::Shape shape;
-        double advance;
+        glyph_source source;
 
-        if (!msdfgen::loadGlyph(shape, font.get(), unicode, &advance)) {
+        if (!load_source(unicode, source)) {
             return glyphs.at(0);
         }
 
-        shape.normalize();
-        msdfgen::edgeColoringSimple(shape, 3.0);
+        generate_pixels(source);
 
-        double left=0, bottom=0, right=0, top=0;
-        shape.bounds(left, bottom, right, top);
+        iter = glyphs.insert({unicode, upload(source)}).first;
+    }
 
-        left -= 1;
-        bottom -= 1;
-        right += 1;
-        top += 1;
+    return iter->second;
+}
 
-        auto width = int(right - left + 1);
-        auto height = int(top - bottom + 1);
+void msdf_font::preload(const std::string& chars, job_system& jobs) const {
+    std::vector<glyph_source> sources;
+    sources.reserve(chars.size());
 
-        msdfgen::Bitmap<msdfgen::FloatRGB> msdf(width, height);
-        msdfgen::generateMSDF(msdf, shape, 4.0, 1.0, msdfgen::Vector2(-left, -bottom));
+    // FreeType is not thread-safe, so outlines are loaded here and only the MSDF generation is spread across the pool.
+    for (auto c : chars) {
+        auto unicode = int(static_cast<unsigned char>(c));
 
-        std::vector<unsigned char> pixels;
-        pixels.reserve(4*msdf.width()*msdf.height());
-        for (int y = 0; y < msdf.height(); ++y) {
-            for (int x = 0; x < msdf.width(); ++x) {
-                pixels.push_back(msdfgen::clamp(int(msdf(x, y).r*0x100), 0xff));
-                pixels.push_back(msdfgen::clamp(int(msdf(x, y).g*0x100), 0xff));
-                pixels.push_back(msdfgen::clamp(int(msdf(x, y).b*0x100), 0xff));
-                pixels.push_back(255);
-            }
+        if (glyphs.count(unicode) != 0) {
+            continue;
         }
 
-        double em;
-        msdfgen::getFontScale(em, font.get());
+        auto already_queued = std::any_of(begin(sources), end(sources), [&](const glyph_source& s) {
+            return s.unicode == unicode;
+        });
 
-        left /= em;
-        right /= em;
-        bottom /= em;
-        top /= em;
-        advance /= em;
+        if (already_queued) {
+            continue;
+        }
 
-        auto g = glyph{};
+        sources.emplace_back();
 
-        g.mesh = sushi::load_static_mesh_data(
-            {{left, bottom, 0.f},{left, top, 0.f},{right, top, 0.f},{right, bottom, 0.f}},
-            {{0.f, 0.f, 1.f},{0.f, 0.f, 1.f},{0.f, 0.f, 1.f},{0.f, 0.f, 1.f}},
-            {{0.f, 0.f},{0.f, 1.f},{1.f, 1.f},{1.f, 0.f}},
-            {{{{0,0,0},{1,1,1},{2,2,2}}},{{{2,2,2},{3,3,3},{0,0,0}}}});
+        if (!load_source(unicode, sources.back())) {
+            sources.pop_back();
+        }
+    }
 
-        g.texture.handle = sushi::make_unique_texture();
-        g.texture.width = width;
-        g.texture.height = height;
+    jobs.parallel_for(0, sources.size(), 1, [&](std::size_t first, std::size_t last) {
+        for (auto i = first; i < last; ++i) {
+            generate_pixels(sources[i]);
+        }
+    });
 
-        glBindTexture(GL_TEXTURE_2D, g.texture.handle.get());
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, msdf.width(), msdf.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+    for (auto& source : sources) {
+        glyphs.insert({source.unicode, upload(source)});
+    }
+}
 
-        g.advance = advance;
+bool msdf_font::load_source(int unicode, glyph_source& source) const {
+    source.unicode = unicode;
 
-        iter = glyphs.insert({unicode, std::move(g)}).first;
+    if (!msdfgen::loadGlyph(source.shape, font.get(), unicode, &source.advance)) {
+        return false;
     }
 
-    return iter->second;
+    source.shape.normalize();
+    msdfgen::edgeColoringSimple(source.shape, 3.0);
+
+    source.shape.bounds(source.left, source.bottom, source.right, source.top);
+
+    source.left -= 1;
+    source.bottom -= 1;
+    source.right += 1;
+    source.top += 1;
+
+    source.width = int(source.right - source.left + 1);
+    source.height = int(source.top - source.bottom + 1);
+
+    msdfgen::getFontScale(source.em, font.get());
+
+    return true;
+}
+
+void msdf_font::generate_pixels(glyph_source& source) {
+    msdfgen::Bitmap<msdfgen::FloatRGB> msdf(source.width, source.height);
+    msdfgen::generateMSDF(msdf, source.shape, 4.0, 1.0, msdfgen::Vector2(-source.left, -source.bottom));
+
+    auto& pixels = source.pixels;
+    pixels.clear();
+    pixels.reserve(4*msdf.width()*msdf.height());
+    for (int y = 0; y < msdf.height(); ++y) {
+        for (int x = 0; x < msdf.width(); ++x) {
+            pixels.push_back(msdfgen::clamp(int(msdf(x, y).r*0x100), 0xff));
+            pixels.push_back(msdfgen::clamp(int(msdf(x, y).g*0x100), 0xff));
+            pixels.push_back(msdfgen::clamp(int(msdf(x, y).b*0x100), 0xff));
+            pixels.push_back(255);
+        }
+    }
+}
+
+msdf_font::glyph msdf_font::upload(const glyph_source& source) {
+    auto left = float(source.left / source.em);
+    auto right = float(source.right / source.em);
+    auto bottom = float(source.bottom / source.em);
+    auto top = float(source.top / source.em);
+    auto advance = float(source.advance / source.em);
+
+    auto g = glyph{};
+
+    g.mesh = sushi::load_static_mesh_data(
+        {{left, bottom, 0.f},{left, top, 0.f},{right, top, 0.f},{right, bottom, 0.f}},
+        {{0.f, 0.f, 1.f},{0.f, 0.f, 1.f},{0.f, 0.f, 1.f},{0.f, 0.f, 1.f}},
+        {{0.f, 0.f},{0.f, 1.f},{1.f, 1.f},{1.f, 0.f}},
+        {{{{0,0,0},{1,1,1},{2,2,2}}},{{{2,2,2},{3,3,3},{0,0,0}}}});
+
+    g.texture.handle = sushi::make_unique_texture();
+    g.texture.width = source.width;
+    g.texture.height = source.height;
+
+    glBindTexture(GL_TEXTURE_2D, g.texture.handle.get());
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, source.width, source.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &source.pixels[0]);
+
+    g.advance = advance;
+
+    return g;
 }
 
 //msdf_font::msdf_font(const std::string& fontname) {
@@ -11,6 +11,9 @@
 #include <string>
 #include <unordered_map>
 #include <memory>
+#include <vector>
+
+class job_system;
 
 struct FontDeleter {
     void operator()(msdfgen::FontHandle* ptr) {
@@ -31,7 +34,25 @@ public:
 
     const glyph& get_glyph(int unicode) const;
 
+    /*! Builds the glyphs for each character in `chars` up front, generating the distance fields on the pool. */
+    void preload(const std::string& chars, job_system& jobs) const;
+
 private:
+    struct glyph_source {
+        int unicode = 0;
+        msdfgen::Shape shape;
+        double left = 0, bottom = 0, right = 0, top = 0;
+        double advance = 0;
+        double em = 1;
+        int width = 0;
+        int height = 0;
+        std::vector<unsigned char> pixels;
+    };
+
+    bool load_source(int unicode, glyph_source& source) const;
+    static void generate_pixels(glyph_source& source);
+    static glyph upload(const glyph_source& source);
+
     std::unique_ptr<msdfgen::FontHandle, FontDeleter> font;
     mutable std::unordered_map<int, glyph> glyphs;
 };
@@ -0,0 +1,87 @@
+#include "frame_pacer.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+frame_pacer::frame_pacer(const nlohmann::json& config) {
+    auto vsync_name = config["vsync"].get<std::string>();
+
+    if (vsync_name == "off") {
+        vsync = vsync_mode::off;
+    } else if (vsync_name == "on") {
+        vsync = vsync_mode::on;
+    } else if (vsync_name == "adaptive") {
+        vsync = vsync_mode::adaptive;
+    } else {
+        throw std::runtime_error("Unknown vsync mode: " + vsync_name);
+    }
+
+    auto target_fps = double(config["target_fps"]);
+
+    if (target_fps > 0) {
+        target_frame_time = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / target_fps));
+    }
+
+    spin_time = std::chrono::microseconds(int(config["spin_us"]));
+    idle_timeout_ms = int(config["idle_timeout_ms"]);
+}
+
+void frame_pacer::apply_swap_interval() {
+#ifndef __EMSCRIPTEN__
+    switch (vsync) {
+        case vsync_mode::off:
+            SDL_GL_SetSwapInterval(0);
+            break;
+        case vsync_mode::on:
+            SDL_GL_SetSwapInterval(1);
+            break;
+        case vsync_mode::adaptive:
+            if (SDL_GL_SetSwapInterval(-1) != 0) {
+                std::clog << "Warning: Adaptive vsync unsupported, using vsync." << std::endl;
+                vsync = vsync_mode::on;
+                SDL_GL_SetSwapInterval(1);
+            }
+            break;
+    }
+#endif
+}
+
+void frame_pacer::limit(clock::time_point frame_start) const {
+#ifndef __EMSCRIPTEN__
+    if (target_frame_time == clock::duration::zero()) {
+        return;
+    }
+
+    const auto deadline = frame_start + target_frame_time;
+
+    if (clock::now() < deadline - spin_time) {
+        std::this_thread::sleep_until(deadline - spin_time);
+    }
+
+    while (clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+#endif
+}
+
+bool frame_pacer::can_idle() const {
+#ifndef __EMSCRIPTEN__
+    return idle_timeout_ms > 0;
+#else
+    return false;
+#endif
+}
+
+bool frame_pacer::idle(SDL_Event& event) const {
+#ifndef __EMSCRIPTEN__
+    return SDL_WaitEventTimeout(&event, idle_timeout_ms);
+#else
+    return false;
+#endif
+}
+
+auto frame_pacer::get_vsync_mode() const -> vsync_mode {
+    return vsync;
+}
@@ -0,0 +1,52 @@
+#ifndef LD42_FRAME_PACER_HPP
+#define LD42_FRAME_PACER_HPP
+
+#include "json.hpp"
+#include "sdl.hpp"
+
+#include <chrono>
+
+// Frame pacing.
+//
+// Controls the swap interval, limits the frame rate to a target frame time, and idles the main loop
+// while nothing on screen can change.
+//
+// The limiter sleeps for most of the remaining frame time, then spins for the last `spin_us`
+// microseconds, since sleeps are only accurate to the scheduler's granularity.
+//
+// On Emscripten the browser paces frames, so the swap interval, limiter, and idling do nothing.
+class frame_pacer {
+public:
+    using clock = std::chrono::steady_clock;
+
+    enum class vsync_mode {
+        off,
+        on,
+        adaptive,
+    };
+
+    frame_pacer() = default;
+    frame_pacer(const nlohmann::json& config);
+
+    // Sets the swap interval of the current GL context, falling back to vsync if adaptive is unsupported.
+    void apply_swap_interval();
+
+    // Waits until the target frame time has passed since `frame_start`.
+    void limit(clock::time_point frame_start) const;
+
+    // Whether idle blocks at all, which it does not on Emscripten or with an idle timeout of 0.
+    bool can_idle() const;
+
+    // Blocks until an event arrives or the idle timeout expires. Returns true if an event was received.
+    bool idle(SDL_Event& event) const;
+
+    vsync_mode get_vsync_mode() const;
+
+private:
+    vsync_mode vsync = vsync_mode::on;
+    clock::duration target_frame_time = {};
+    clock::duration spin_time = {};
+    int idle_timeout_ms = 0;
+};
+
+#endif //LD42_FRAME_PACER_HPP
@@ -2,22 +2,41 @@
 
 #include "systems.hpp"
 
+#include <array>
 #include <chrono>
 
-auto gameplay_state(std::function<void(const std::string&)> set_state) -> std::function<void(ld42_engine&, double)> {
-    return [set_state](ld42_engine& engine, double delta) {
-        if (engine.input_table["restart"]) {
+auto gameplay_state(std::function<void(const std::string&)> set_state) -> game_state {
+    auto update = [set_state, sections = std::array<profiler::section*, 6>{}](ld42_engine& engine, double delta) mutable {
+        if (engine.actions[input::action::restart].down) {
             set_state("main_menu");
             return;
         }
 
-        systems::movement(engine, delta);
-        systems::collision(engine, delta);
-        systems::scripting(engine, delta);
-        systems::death_timer(engine, delta);
-        systems::render(engine, delta);
-        systems::board_tick(engine, delta);
+        // Sections are looked up on the first tick only.
+        auto run = [&](std::size_t index, const char* name, auto&& system) {
+            auto& section = sections[index];
+            if (!section) {
+                section = &engine.frame_profiler.get_section(name);
+            }
+            auto timer = section->time();
+            system(engine, delta);
+        };
 
+        run(0, "movement", systems::movement);
+        run(1, "collision", systems::collision);
+        run(2, "scripting", systems::scripting);
+        run(3, "death_timer", systems::death_timer);
+        run(4, "particles", systems::particles);
+        run(5, "board_tick", systems::board_tick);
+    };
+
+    auto draw = [](ld42_engine& engine, double alpha, draw_list& scene) {
+        systems::draw(engine, alpha, scene);
+    };
+
+    auto render = [](ld42_engine& engine, double alpha) {
         engine.root_widget->show();
     };
-}
\ No newline at end of file
+
+    return {update, render, false, draw};
+}
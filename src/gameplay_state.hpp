@@ -5,6 +5,6 @@
 
 #include <functional>
 
-auto gameplay_state(std::function<void(const std::string&)> set_state) -> std::function<void(ld42_engine&, double)>;
+auto gameplay_state(std::function<void(const std::string&)> set_state) -> game_state;
 
 #endif // LD42_GAMEPLAY_STATE
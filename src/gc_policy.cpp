@@ -0,0 +1,76 @@
+#include "gc_policy.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+gc_policy::gc_policy(lua_State* lua, const nlohmann::json& config) :
+    lua(lua),
+    budget(int(config["budget_us"])),
+    step_kb(int(config["step_kb"])),
+    emergency_multiplier(int(config["emergency_multiplier"]))
+{
+    auto mode_name = config["mode"].get<std::string>();
+
+    if (mode_name == "incremental") {
+        gc_mode = mode::incremental;
+    } else if (mode_name == "full") {
+        gc_mode = mode::full;
+    } else {
+        throw std::runtime_error("Unknown Lua GC mode: " + mode_name);
+    }
+
+    if (gc_mode == mode::incremental) {
+        lua_gc(lua, LUA_GCSTOP, 0);
+    }
+
+    baseline_kb = get_heap_kb();
+}
+
+void gc_policy::step(profiler& prof) {
+    const auto start = profiler::clock::now();
+
+    switch (gc_mode) {
+        case mode::full: {
+            lua_gc(lua, LUA_GCCOLLECT, 0);
+            baseline_kb = get_heap_kb();
+            break;
+        }
+        case mode::incremental: {
+            if (get_heap_kb() > std::max(baseline_kb, 1024) * emergency_multiplier) {
+                // Garbage is outpacing the budget, take the hit now rather than run out of memory.
+                if (!full_section) {
+                    full_section = &prof.get_section("gc_full");
+                }
+                auto timer = full_section->time();
+                lua_gc(lua, LUA_GCCOLLECT, 0);
+                baseline_kb = get_heap_kb();
+                break;
+            }
+
+            const auto deadline = start + budget;
+
+            do {
+                if (lua_gc(lua, LUA_GCSTEP, step_kb)) {
+                    baseline_kb = get_heap_kb();
+                    break;
+                }
+            } while (profiler::clock::now() < deadline);
+            break;
+        }
+    }
+
+    const auto duration = profiler::clock::now() - start;
+    last_pause = std::chrono::duration_cast<std::chrono::microseconds>(duration);
+    if (!pause_section) {
+        pause_section = &prof.get_section("gc");
+    }
+    pause_section->record(duration);
+}
+
+std::chrono::microseconds gc_policy::get_last_pause() const {
+    return last_pause;
+}
+
+int gc_policy::get_heap_kb() const {
+    return lua_gc(lua, LUA_GCCOUNT, 0);
+}
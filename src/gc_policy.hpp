@@ -0,0 +1,49 @@
+#ifndef LD42_GC_POLICY_HPP
+#define LD42_GC_POLICY_HPP
+
+#include "json.hpp"
+#include "profiler.hpp"
+
+#include <sol.hpp>
+
+#include <chrono>
+
+// Lua garbage collection policy.
+//
+// In incremental mode, Lua's automatic collector is stopped and the collector is instead stepped
+// once per frame until either the time budget is spent or a cycle completes. If the heap grows past
+// a multiple of its size after the last completed cycle, a full collection is forced.
+//
+// In full mode, a full collection is done every frame.
+class gc_policy {
+public:
+    enum class mode {
+        incremental,
+        full,
+    };
+
+    gc_policy() = default;
+    gc_policy(lua_State* lua, const nlohmann::json& config);
+
+    // Runs the collector for this frame and records pause times to the profiler.
+    void step(profiler& prof);
+
+    // Duration of the most recent collection pause.
+    std::chrono::microseconds get_last_pause() const;
+
+    // Size of the Lua heap, in kilobytes.
+    int get_heap_kb() const;
+
+private:
+    lua_State* lua = nullptr;
+    mode gc_mode = mode::full;
+    std::chrono::microseconds budget = {};
+    int step_kb = 0;
+    int emergency_multiplier = 0;
+    int baseline_kb = 0;
+    std::chrono::microseconds last_pause = {};
+    profiler::section* pause_section = nullptr;
+    profiler::section* full_section = nullptr;
+};
+
+#endif //LD42_GC_POLICY_HPP
@@ -0,0 +1,154 @@
+#include "input.hpp"
+
+#include <iostream>
+
+namespace input {
+
+namespace {
+
+const char* const action_names[action_count] = {
+    "left",
+    "right",
+    "up",
+    "down",
+    "shoot",
+    "rotate_cw",
+    "rotate_ccw",
+    "restart",
+    "music",
+};
+
+} //static
+
+const char* get_name(action a) {
+    return action_names[static_cast<std::size_t>(a)];
+}
+
+std::optional<action> find_action(const std::string& name) {
+    for (auto i = std::size_t{0}; i < action_count; ++i) {
+        if (name == action_names[i]) {
+            return static_cast<action>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+action_table::action_table(const nlohmann::json& config) {
+    repeat_delay = double(config["repeat_delay"]);
+
+    const auto& binding_config = config["bindings"];
+
+    for (auto it = binding_config.begin(); it != binding_config.end(); ++it) {
+        auto a = find_action(it.key());
+
+        if (!a) {
+            std::clog << "Warning: Binding for unknown action " << it.key() << "!" << std::endl;
+            continue;
+        }
+
+        for (const auto& key_name : it.value()) {
+            auto scancode = SDL_GetScancodeFromName(key_name.get<std::string>().c_str());
+
+            if (scancode == SDL_SCANCODE_UNKNOWN) {
+                std::clog << "Warning: Unknown key " << key_name << " bound to " << it.key() << "!" << std::endl;
+                continue;
+            }
+
+            bindings[static_cast<std::size_t>(*a)].push_back(scancode);
+        }
+    }
+}
+
+void action_table::push_event(const SDL_KeyboardEvent& event) {
+    if (event.repeat) {
+        return;
+    }
+
+    events.push_back({event.timestamp, event.keysym.scancode, event.type == SDL_KEYDOWN});
+}
+
+void action_table::update(double delta, Uint32 deadline) {
+    for (auto& state : states) {
+        state.pressed = false;
+        state.released = false;
+        state.repeat = false;
+    }
+
+    // Replay every transition in this tick, so short taps aren't lost.
+    while (!events.empty() && SDL_TICKS_PASSED(deadline, events.front().timestamp)) {
+        const auto event = events.front();
+        events.pop_front();
+
+        if (event.scancode < 0 || event.scancode >= SDL_NUM_SCANCODES) {
+            continue;
+        }
+
+        keys[event.scancode] = event.down;
+
+        for (auto i = std::size_t{0}; i < action_count; ++i) {
+            auto& state = states[i];
+            auto curr = is_bound_down(i);
+
+            if (curr && !state.down) {
+                state.pressed = true;
+                if (!press_times[i]) {
+                    press_times[i] = event.timestamp;
+                }
+            } else if (!curr && state.down) {
+                state.released = true;
+            }
+
+            state.down = curr;
+        }
+    }
+
+    for (auto& state : states) {
+        if (state.pressed) {
+            state.repeat_timer = repeat_delay;
+            state.repeat = true;
+        } else if (state.down) {
+            state.repeat_timer -= delta;
+            if (state.repeat_timer <= 0.0) {
+                state.repeat_timer += repeat_delay;
+                state.repeat = true;
+            }
+        } else {
+            state.repeat_timer = 0.0;
+        }
+    }
+}
+
+const action_state& action_table::operator[](action a) const {
+    return states[static_cast<std::size_t>(a)];
+}
+
+bool action_table::is_bound_down(std::size_t i) const {
+    for (auto scancode : bindings[i]) {
+        if (keys[scancode]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} //namespace input
+
+namespace scripting {
+
+template <>
+void register_type<input::action_table>(sol::table& lua) {
+    lua.new_usertype<input::action_state>("action_state",
+        "down", sol::readonly(&input::action_state::down),
+        "pressed", sol::readonly(&input::action_state::pressed),
+        "released", sol::readonly(&input::action_state::released),
+        "repeating", sol::readonly(&input::action_state::repeat));
+    lua.new_usertype<input::action_table>("action_table",
+        sol::meta_function::index, [](const input::action_table& table, const std::string& name) -> const input::action_state* {
+            if (auto a = input::find_action(name)) {
+                return &table[*a];
+            }
+            return nullptr;
+        });
+}
+
+} //namespace scripting
@@ -0,0 +1,102 @@
+#ifndef LD42_INPUT_HPP
+#define LD42_INPUT_HPP
+
+#include "json.hpp"
+#include "scripting.hpp"
+#include "sdl.hpp"
+
+#include <array>
+#include <deque>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace input {
+
+enum class action {
+    left,
+    right,
+    up,
+    down,
+    shoot,
+    rotate_cw,
+    rotate_ccw,
+    restart,
+    music,
+    count,
+};
+
+constexpr auto action_count = static_cast<std::size_t>(action::count);
+
+const char* get_name(action a);
+
+std::optional<action> find_action(const std::string& name);
+
+struct action_state {
+    bool down = false;
+    bool pressed = false;
+    bool released = false;
+    bool repeat = false;
+    double repeat_timer = 0;
+};
+
+// Dense table of action states.
+//
+// Bindings map each action to any number of scancodes, and are loaded from the "input" config.
+//
+// Key events are queued with their SDL timestamps and consumed by the simulation tick they fall in,
+// so a press is seen by the earliest tick that could react to it, and a press and release within
+// one tick still registers as pressed.
+class action_table {
+public:
+    action_table() = default;
+    action_table(const nlohmann::json& config);
+
+    // Queues a key event. Key repeats are ignored.
+    void push_event(const SDL_KeyboardEvent& event);
+
+    // Applies queued events up to the deadline (in SDL ticks) and advances repeat timers.
+    void update(double delta, Uint32 deadline);
+
+    const action_state& operator[](action a) const;
+
+    // Calls `func(action, timestamp)` for each action pressed since the last call.
+    //
+    // Called once a frame has been presented, to measure input-to-visible latency.
+    template <typename F>
+    void consume_press_times(F&& func) {
+        for (auto i = std::size_t{0}; i < action_count; ++i) {
+            if (press_times[i]) {
+                func(static_cast<action>(i), *press_times[i]);
+                press_times[i] = std::nullopt;
+            }
+        }
+    }
+
+private:
+    struct key_event {
+        Uint32 timestamp;
+        SDL_Scancode scancode;
+        bool down;
+    };
+
+    bool is_bound_down(std::size_t i) const;
+
+    std::array<action_state, action_count> states;
+    std::array<std::vector<SDL_Scancode>, action_count> bindings;
+    std::array<std::optional<Uint32>, action_count> press_times;
+    std::array<bool, SDL_NUM_SCANCODES> keys = {};
+    std::deque<key_event> events;
+    double repeat_delay = 0.1;
+};
+
+} //namespace input
+
+namespace scripting {
+
+template <>
+void register_type<input::action_table>(sol::table& lua);
+
+} //namespace scripting
+
+#endif //LD42_INPUT_HPP
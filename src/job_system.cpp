@@ -0,0 +1,223 @@
+#include "job_system.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// The pool and queue index of the current thread, if it is a worker.
+thread_local job_system* current_pool = nullptr;
+thread_local std::size_t current_index = 0;
+
+} //static
+
+auto job_system::task_graph::add(std::function<void()> func) -> node_id {
+    nodes.push_back({std::move(func), {}, 0});
+    return nodes.size() - 1;
+}
+
+void job_system::task_graph::precede(node_id before, node_id after) {
+    nodes[before].successors.push_back(after);
+    ++nodes[after].predecessors;
+}
+
+job_system::job_system(int worker_count) :
+    pending(0),
+    next_queue(0),
+    stopping(false),
+    busy_ns(0)
+{
+#ifdef __EMSCRIPTEN__
+    // Built without pthreads.
+    worker_count = 0;
+#endif
+
+    for (auto i = 0; i < worker_count; ++i) {
+        queues.push_back(std::make_unique<worker_queue>());
+    }
+
+    for (auto i = 0; i < worker_count; ++i) {
+        workers.emplace_back([this, i] { worker_main(i); });
+    }
+}
+
+job_system::~job_system() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+int job_system::get_worker_count() const {
+    return int(workers.size());
+}
+
+void job_system::run(task_graph& graph) {
+    const auto node_count = graph.nodes.size();
+
+    if (node_count == 0) {
+        return;
+    }
+
+    auto remaining = std::atomic<std::size_t>(node_count);
+    auto predecessors = std::make_unique<std::atomic<int>[]>(node_count);
+    auto failed = std::atomic<bool>(false);
+    auto error = std::exception_ptr{};
+    auto error_mutex = std::mutex{};
+
+    for (auto i = std::size_t{0}; i < node_count; ++i) {
+        predecessors[i] = graph.nodes[i].predecessors;
+    }
+
+    // Failed and skipped nodes still release their successors, so every node is counted down.
+    std::function<void(task_graph::node_id)> schedule;
+    schedule = [&](task_graph::node_id id) {
+        submit([&, id] {
+            auto& node = graph.nodes[id];
+            if (!failed) {
+                try {
+                    node.func();
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    failed = true;
+                }
+            }
+            for (auto succ : node.successors) {
+                if (--predecessors[succ] == 0) {
+                    schedule(succ);
+                }
+            }
+            --remaining;
+        });
+    };
+
+    for (auto i = std::size_t{0}; i < node_count; ++i) {
+        if (graph.nodes[i].predecessors == 0) {
+            schedule(i);
+        }
+    }
+
+    wait_for(remaining);
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void job_system::run_main_tasks() {
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(main_mutex);
+        tasks.swap(main_tasks);
+    }
+
+    for (auto& task : tasks) {
+        task();
+    }
+}
+
+auto job_system::take_busy_time() -> clock::duration {
+    return std::chrono::nanoseconds(busy_ns.exchange(0));
+}
+
+void job_system::submit(std::function<void()> task) {
+    if (workers.empty()) {
+        task();
+        return;
+    }
+
+    auto index = current_pool == this ? current_index : next_queue++ % queues.size();
+
+    {
+        auto& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    ++pending;
+
+    {
+        // Taking the lock orders this against a worker that is about to sleep.
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+    }
+    wake.notify_one();
+}
+
+bool job_system::try_run_one() {
+    if (queues.empty()) {
+        return false;
+    }
+
+    std::function<void()> task;
+
+    const auto own = current_pool == this;
+    const auto start = own ? current_index : next_queue.load() % queues.size();
+
+    // Own queue first, newest task first, then steal the oldest task from the others.
+    if (own) {
+        auto& queue = *queues[start];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+    }
+
+    for (auto i = std::size_t{0}; !task && i < queues.size(); ++i) {
+        auto& queue = *queues[(start + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+
+    if (!task) {
+        return false;
+    }
+
+    --pending;
+
+    if (own) {
+        const auto task_start = clock::now();
+        task();
+        busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - task_start).count();
+    } else {
+        task();
+    }
+
+    return true;
+}
+
+void job_system::wait_for(const std::atomic<std::size_t>& remaining) {
+    while (remaining > 0) {
+        if (!try_run_one()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void job_system::worker_main(std::size_t index) {
+    current_pool = this;
+    current_index = index;
+
+    while (true) {
+        if (try_run_one()) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [&] { return stopping || pending > 0; });
+
+        if (stopping && pending == 0) {
+            return;
+        }
+    }
+}
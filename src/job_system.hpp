@@ -0,0 +1,157 @@
+#ifndef LD42_JOB_SYSTEM_HPP
+#define LD42_JOB_SYSTEM_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Work-stealing thread pool.
+//
+// Each worker owns a task queue. Workers run their own tasks newest-first and steal the oldest
+// tasks from other workers when they run out. Threads that wait on a parallel_for or a task graph
+// run queued tasks while they wait, so waiting from inside a task cannot deadlock.
+//
+// A pool with no workers runs everything inline on the calling thread.
+//
+// Tasks that need the GL context or the Lua state can be queued with run_on_main, and are run by
+// the main thread when it calls run_main_tasks.
+class job_system {
+public:
+    using clock = std::chrono::steady_clock;
+
+    // A set of tasks with ordering constraints, run all at once by job_system::run.
+    class task_graph {
+    public:
+        using node_id = std::size_t;
+
+        node_id add(std::function<void()> func);
+
+        // Makes `after` wait until `before` has finished.
+        void precede(node_id before, node_id after);
+
+    private:
+        friend class job_system;
+
+        struct node {
+            std::function<void()> func;
+            std::vector<node_id> successors;
+            int predecessors = 0;
+        };
+
+        std::vector<node> nodes;
+    };
+
+    explicit job_system(int worker_count);
+    job_system(const job_system&) = delete;
+    job_system& operator=(const job_system&) = delete;
+    ~job_system();
+
+    int get_worker_count() const;
+
+    // Runs a function on the pool.
+    template <typename F>
+    auto async(F&& func) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using result_type = std::invoke_result_t<std::decay_t<F>>;
+        auto task = std::make_shared<std::packaged_task<result_type()>>(std::forward<F>(func));
+        auto future = task->get_future();
+        submit([task] { (*task)(); });
+        return future;
+    }
+
+    // Calls `func(begin, end)` over subranges of [first, last) of at most `grain` indices, and waits for all of them.
+    template <typename F>
+    void parallel_for(std::size_t first, std::size_t last, std::size_t grain, F&& func) {
+        if (grain == 0) {
+            grain = 1;
+        }
+
+        if (workers.empty() || last - first <= grain) {
+            if (first < last) {
+                func(first, last);
+            }
+            return;
+        }
+
+        auto remaining = std::atomic<std::size_t>((last - first + grain - 1) / grain);
+        auto error = std::exception_ptr{};
+        auto error_mutex = std::mutex{};
+
+        for (auto begin = first; begin < last; begin += grain) {
+            auto end = std::min(begin + grain, last);
+            submit([&, begin, end] {
+                try {
+                    func(begin, end);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    error = std::current_exception();
+                }
+                --remaining;
+            });
+        }
+
+        wait_for(remaining);
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Runs every task in the graph, respecting its ordering constraints, and waits for all of them.
+    //
+    // If a task throws, tasks that have not started yet are skipped, and the first exception is
+    // rethrown once the running ones have finished.
+    void run(task_graph& graph);
+
+    // Queues a function to be run on the main thread. Must not be waited on from the main thread.
+    template <typename F>
+    auto run_on_main(F&& func) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using result_type = std::invoke_result_t<std::decay_t<F>>;
+        auto task = std::make_shared<std::packaged_task<result_type()>>(std::forward<F>(func));
+        auto future = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(main_mutex);
+            main_tasks.push_back([task] { (*task)(); });
+        }
+        return future;
+    }
+
+    // Runs the tasks queued with run_on_main. Must be called from the main thread.
+    void run_main_tasks();
+
+    // Total time workers have spent running tasks since the last call.
+    clock::duration take_busy_time();
+
+private:
+    struct worker_queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void submit(std::function<void()> task);
+    bool try_run_one();
+    void wait_for(const std::atomic<std::size_t>& remaining);
+    void worker_main(std::size_t index);
+
+    std::vector<std::unique_ptr<worker_queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::atomic<std::size_t> pending;
+    std::atomic<std::size_t> next_queue;
+    std::atomic<bool> stopping;
+    std::atomic<std::int64_t> busy_ns;
+    std::mutex main_mutex;
+    std::vector<std::function<void()>> main_tasks;
+};
+
+#endif //LD42_JOB_SYSTEM_HPP
@@ -29,7 +29,9 @@
 #endif
 
 #include <cmath>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <memory>
@@ -39,7 +41,7 @@
 
 using namespace std::literals;
 
-std::function<void(ld42_engine& engine, double delta)> loop;
+game_state loop;
 void main_loop(void* engine_ptr) try {
     auto& engine = *static_cast<ld42_engine*>(engine_ptr);
     engine.step(loop);
@@ -49,11 +51,25 @@ void main_loop(void* engine_ptr) try {
 }
 
 int main(int argc, char* argv[]) try {
-    auto engine = ld42_engine();
+    auto headless = false;
+    auto max_ticks = std::uint64_t{0};
+
+    for (int i = 1; i < argc; ++i) {
+        auto arg = std::string(argv[i]);
+        if (arg == "--headless") {
+            headless = true;
+        } else if (arg.rfind("--ticks=", 0) == 0) {
+            max_ticks = std::stoull(arg.substr(8));
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+        }
+    }
+
+    auto engine = ld42_engine(headless);
 
-    std::function<void(ld42_engine&, double)> main_menu_loop;
-    std::function<void(ld42_engine&, double)> game_over_loop;
-    std::function<void(ld42_engine&, double)> win_loop;
+    game_state main_menu_loop;
+    game_state game_over_loop;
+    game_state win_loop;
 
     std::function<void(const std::string&)> set_game_state;
     set_game_state = [&](const std::string& name) {
@@ -83,31 +99,30 @@ int main(int argc, char* argv[]) try {
         auto menu_screen = std::make_shared<gui::screen>(glm::vec2{320, 240});
         menu_screen->add_child(bg);
 
-        return [menu_screen, on_next](ld42_engine& engine, double delta) {
-            // Update
-
-            if (engine.fade == 1.f && engine.input_table["shoot_pressed"]) {
+        auto update = [on_next](ld42_engine& engine, double delta) {
+            if (engine.fade == 1.f && engine.actions[input::action::shoot].pressed) {
                 engine.fade_dir = -1.f;
             } else if (engine.fade == 0.f) {
                 engine.fade_dir = 1.f;
                 on_next();
                 return;
             }
+        };
 
-            // Render
-
-            engine.renderer.begin();
-            EMBER_DEFER { engine.renderer.end(); };
-            menu_screen->draw(engine.renderer, {0, 0});
+        auto render = [menu_screen](ld42_engine& engine, double alpha) {
+            engine.renderer->begin();
+            EMBER_DEFER { engine.renderer->end(); };
+            menu_screen->draw(*engine.renderer, {0, 0});
         };
+
+        return game_state{update, render, true};
     };
 
-    main_menu_loop = make_menu_state("main_menu", [&] {
-        engine.entities.visit([&](ember_database::ent_id eid) {
-            engine.entities.destroy_entity(eid);
-        });
+    auto start_game = [&] {
         engine.fade = 0.0;
         engine.fade_dir = 1.0;
+
+        // Clears the previous game's world.
         engine.load_world(nlohmann::json::array({}));
 
         auto active = engine.entities.create_entity();
@@ -124,7 +139,10 @@ int main(int argc, char* argv[]) try {
         engine.score = 0;
         engine.combo = 0;
         engine.lines_cleared = 0;
-        
+    };
+
+    main_menu_loop = make_menu_state("main_menu", [&] {
+        start_game();
         set_game_state("gameplay");
     });
 
@@ -142,6 +160,40 @@ int main(int argc, char* argv[]) try {
 
     engine.toggle_music("bgm");
 
+    if (headless) {
+        // Soak run: play with no input, restart on game over, and report throughput.
+        start_game();
+        set_game_state("gameplay");
+
+        auto report_time = ld42_engine::clock::now();
+        auto report_ticks = engine.tick_count;
+
+        while (engine.running && (max_ticks == 0 || engine.tick_count < max_ticks)) {
+            main_loop(&engine);
+
+            auto has_board = false;
+            engine.entities.visit([&](const component::board&) {
+                has_board = true;
+            });
+            if (!has_board) {
+                start_game();
+            }
+
+            const auto now = ld42_engine::clock::now();
+            if (now - report_time >= 1s) {
+                const auto seconds = std::chrono::duration<double>(now - report_time).count();
+                const auto ticks = engine.tick_count - report_ticks;
+                std::cout << "Headless: " << std::lround(ticks / seconds) << " ticks/sec, "
+                          << engine.tick_count << " ticks total, "
+                          << engine.entities.size() << " entities" << std::endl;
+                report_time = now;
+                report_ticks = engine.tick_count;
+            }
+        }
+
+        return EXIT_SUCCESS;
+    }
+
 #ifdef __EMSCRIPTEN__
     emscripten_set_main_loop_arg(main_loop, &engine, 0, 1);
 #else
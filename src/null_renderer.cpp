@@ -0,0 +1,13 @@
+#include "null_renderer.hpp"
+
+void null_renderer::begin() {}
+
+void null_renderer::end() {}
+
+void null_renderer::draw_rectangle(const std::string& texture, glm::vec2 position, glm::vec2 size) {}
+
+void null_renderer::draw_text(const std::string& text, const std::string& font, const glm::vec4& color, glm::vec2 position, float size) {}
+
+float null_renderer::get_text_width(const std::string& text, const std::string& font) {
+    return 0.f;
+}
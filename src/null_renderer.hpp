@@ -0,0 +1,18 @@
+#ifndef LD42_NULL_RENDERER_HPP
+#define LD42_NULL_RENDERER_HPP
+
+#include "gui.hpp"
+
+#include <string>
+
+// Renders nothing. Used by headless engines, which have no GL context.
+class null_renderer : public gui::render_context {
+public:
+    virtual void begin() override;
+    virtual void end() override;
+    virtual void draw_rectangle(const std::string& texture, glm::vec2 position, glm::vec2 size) override;
+    virtual void draw_text(const std::string& text, const std::string& font, const glm::vec4& color, glm::vec2 position, float size) override;
+    virtual float get_text_width(const std::string& text, const std::string& font) override;
+};
+
+#endif //LD42_NULL_RENDERER_HPP
@@ -0,0 +1,147 @@
+#ifndef LD42_PAGED_INDEX_HPP
+#define LD42_PAGED_INDEX_HPP
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Maps integer keys to values by direct indexing into fixed-size pages.
+// Meant for keys handed out sequentially: lookups are two array accesses, and pages are
+// allocated on first use and freed again once empty. Keys that are negative or too large
+// for the page table fall back to a hash map.
+template <typename T, std::size_t PageBits = 12>
+class paged_index {
+public:
+    using key_type = std::int64_t;
+
+    static constexpr std::size_t page_size = std::size_t{1} << PageBits;
+    static constexpr key_type max_paged_key = key_type{1} << 28;
+
+    T* find(key_type key) {
+        if (!is_paged(key)) {
+            auto iter = overflow.find(key);
+            return iter != overflow.end() ? &iter->second : nullptr;
+        }
+
+        auto p = page_of(key);
+        if (p >= pages.size() || !pages[p]) {
+            return nullptr;
+        }
+
+        auto& pg = *pages[p];
+        auto slot = slot_of(key);
+        return pg.used[slot] ? &pg.slots[slot] : nullptr;
+    }
+
+    // Returns the value and true, or the existing value and false if the key is already present.
+    std::pair<T*, bool> insert(key_type key, T value) {
+        if (!is_paged(key)) {
+            auto [iter, inserted] = overflow.emplace(key, std::move(value));
+            if (inserted) {
+                ++count;
+            }
+            return {&iter->second, inserted};
+        }
+
+        auto p = page_of(key);
+        if (p >= pages.size()) {
+            pages.resize(p + 1);
+        }
+        if (!pages[p]) {
+            pages[p] = std::make_unique<page>();
+        }
+
+        auto& pg = *pages[p];
+        auto slot = slot_of(key);
+
+        if (pg.used[slot]) {
+            return {&pg.slots[slot], false};
+        }
+
+        pg.slots[slot] = std::move(value);
+        pg.used[slot] = true;
+        ++pg.count;
+        ++count;
+
+        return {&pg.slots[slot], true};
+    }
+
+    bool erase(key_type key) {
+        if (!is_paged(key)) {
+            if (overflow.erase(key) == 0) {
+                return false;
+            }
+            --count;
+            return true;
+        }
+
+        auto p = page_of(key);
+        if (p >= pages.size() || !pages[p]) {
+            return false;
+        }
+
+        auto& pg = *pages[p];
+        auto slot = slot_of(key);
+
+        if (!pg.used[slot]) {
+            return false;
+        }
+
+        pg.slots[slot] = T{};
+        pg.used[slot] = false;
+        --count;
+
+        if (--pg.count == 0) {
+            pages[p].reset();
+        }
+
+        return true;
+    }
+
+    std::size_t size() const {
+        return count;
+    }
+
+    std::size_t page_count() const {
+        return std::count_if(begin(pages), end(pages), [](const auto& p) { return p != nullptr; });
+    }
+
+    // Bytes held by the page table, pages and overflow map. The overflow map's node size is estimated.
+    std::size_t memory_bytes() const {
+        return pages.capacity() * sizeof(std::unique_ptr<page>) +
+            page_count() * sizeof(page) +
+            overflow.bucket_count() * sizeof(void*) +
+            overflow.size() * (sizeof(typename decltype(overflow)::value_type) + 2 * sizeof(void*));
+    }
+
+private:
+    struct page {
+        std::array<T, page_size> slots = {};
+        std::bitset<page_size> used;
+        std::size_t count = 0;
+    };
+
+    static bool is_paged(key_type key) {
+        return key >= 0 && key < max_paged_key;
+    }
+
+    static std::size_t page_of(key_type key) {
+        return std::size_t(key) >> PageBits;
+    }
+
+    static std::size_t slot_of(key_type key) {
+        return std::size_t(key) & (page_size - 1);
+    }
+
+    std::vector<std::unique_ptr<page>> pages;
+    std::unordered_map<key_type, T> overflow;
+    std::size_t count = 0;
+};
+
+#endif //LD42_PAGED_INDEX_HPP
@@ -0,0 +1,127 @@
+#include "prefab.hpp"
+
+#include "component_scripting.hpp"
+
+#include <Meta.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+// Replaces only the members present in the JSON, so overrides can be partial.
+template <typename Com>
+void patch(Com& com, const nlohmann::json& json) {
+    if (!json.is_object()) {
+        com = json.get<Com>();
+        return;
+    }
+
+    meta::doForAllMembers<Com>([&](auto& member) {
+        auto iter = json.find(member.getName());
+        if (iter != json.end()) {
+            using member_type = meta::get_member_type<decltype(member)>;
+            member.set(com, iter->template get<member_type>());
+        }
+    });
+}
+
+// Calls func on the bundle slot whose component is named `name`, returns false if there is none.
+template <typename Bundle, typename Func>
+bool with_slot(Bundle& bundle, const std::string& name, Func&& func) {
+    return std::apply([&](auto&... slots) {
+        auto found = false;
+        auto try_slot = [&](auto& slot) {
+            using com_type = typename std::decay_t<decltype(slot)>::value_type;
+            if (!found && name == meta::getName<com_type>()) {
+                func(slot);
+                found = true;
+            }
+        };
+        (try_slot(slots), ...);
+        return found;
+    }, bundle);
+}
+
+template <typename Bundle>
+void create_components(ember_database& db, ember_database::ent_id eid, const Bundle& bundle) {
+    std::apply([&](const auto&... slots) {
+        auto create = [&](const auto& slot) {
+            if (slot) {
+                db.create_component(eid, *slot);
+            }
+        };
+        (create(slots), ...);
+    }, bundle);
+}
+
+} //namespace
+
+prefab::prefab(const nlohmann::json& data) {
+    for (auto iter = data.begin(); iter != data.end(); ++iter) {
+        if (iter.key() == "net_id") {
+            std::clog << "Warning: Prefabs cannot have a net_id, ignoring it." << std::endl;
+            continue;
+        }
+
+        auto native = with_slot(components, iter.key(), [&](auto& slot) {
+            using com_type = typename std::decay_t<decltype(slot)>::value_type;
+            slot = iter.value().get<com_type>();
+        });
+
+        if (!native) {
+            script_components.emplace_back(iter.key(), iter.value());
+        }
+    }
+}
+
+ember_database::ent_id prefab::instantiate(ember_database& db, const world_loader::fallback& unknown) const {
+    auto eid = db.create_entity();
+
+    create_components(db, eid, components);
+
+    for (const auto& [name, value] : script_components) {
+        unknown(eid, name, value);
+    }
+
+    return eid;
+}
+
+ember_database::ent_id prefab::instantiate(ember_database& db, const nlohmann::json& overrides, const world_loader::fallback& unknown) const {
+    if (overrides.empty()) {
+        return instantiate(db, unknown);
+    }
+
+    auto patched = components;
+    auto scripted = script_components;
+
+    for (auto iter = overrides.begin(); iter != overrides.end(); ++iter) {
+        auto native = with_slot(patched, iter.key(), [&](auto& slot) {
+            if (!slot) {
+                slot.emplace();
+            }
+            patch(*slot, iter.value());
+        });
+
+        if (!native) {
+            auto existing = std::find_if(begin(scripted), end(scripted), [&](const auto& entry) {
+                return entry.first == iter.key();
+            });
+            if (existing != end(scripted)) {
+                existing->second = iter.value();
+            } else {
+                scripted.emplace_back(iter.key(), iter.value());
+            }
+        }
+    }
+
+    auto eid = db.create_entity();
+
+    create_components(db, eid, patched);
+
+    for (const auto& [name, value] : scripted) {
+        unknown(eid, name, value);
+    }
+
+    return eid;
+}
@@ -0,0 +1,51 @@
+#ifndef LD42_PREFAB_HPP
+#define LD42_PREFAB_HPP
+
+#include "components.hpp"
+#include "entities.hpp"
+#include "json.hpp"
+#include "utility.hpp"
+#include "world_loader.hpp"
+
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// An entity template parsed once from JSON.
+//
+// Native components are kept as typed values and copied into each new entity, so spawning does
+// no parsing. Components without a native entry keep their JSON and go to the fallback.
+class prefab {
+public:
+    prefab() = default;
+
+    // Parses a JSON object that maps component names to values, like a world file entry.
+    explicit prefab(const nlohmann::json& data);
+
+    // Creates a new entity with copies of this prefab's components.
+    ember_database::ent_id instantiate(ember_database& db, const world_loader::fallback& unknown) const;
+
+    // Creates a new entity, with the members given in `overrides` replacing the prefab's values.
+    //
+    // Components named in `overrides` but missing from the prefab are added. Script components
+    // are replaced whole.
+    ember_database::ent_id instantiate(ember_database& db, const nlohmann::json& overrides, const world_loader::fallback& unknown) const;
+
+private:
+    template <typename List>
+    struct bundle_of;
+
+    template <typename... Coms>
+    struct bundle_of<utility::type_list<Coms...>> {
+        using type = std::tuple<std::optional<Coms>...>;
+    };
+
+    using bundle = bundle_of<component::all_components>::type;
+
+    bundle components;
+    std::vector<std::pair<std::string, nlohmann::json>> script_components;
+};
+
+#endif //LD42_PREFAB_HPP
@@ -0,0 +1,116 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+profiler::section::section(std::string name) : name(std::move(name)), head(0) {
+    for (auto& sample : samples) {
+        sample.store(0, std::memory_order_relaxed);
+    }
+}
+
+void profiler::section::record(clock::duration duration) {
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    const auto index = head.fetch_add(1, std::memory_order_relaxed);
+    samples[index % sample_count].store(ns, std::memory_order_relaxed);
+}
+
+auto profiler::section::time() -> scoped_timer {
+    return scoped_timer(*this);
+}
+
+profiler::stats profiler::section::get_stats() const {
+    const auto count = std::min(head.load(std::memory_order_relaxed), sample_count);
+
+    auto sorted = std::array<std::int64_t, sample_count>{};
+    for (auto i = std::size_t{0}; i < count; ++i) {
+        sorted[i] = samples[i].load(std::memory_order_relaxed);
+    }
+    std::sort(begin(sorted), begin(sorted) + count);
+
+    auto result = stats{};
+    result.samples = count;
+
+    if (count == 0) {
+        return result;
+    }
+
+    auto percentile = [&](double p) {
+        auto rank = std::size_t(std::ceil(p * count));
+        auto index = std::clamp(rank, std::size_t{1}, count) - 1;
+        return sorted[index] / 1e6;
+    };
+
+    result.p50 = percentile(0.50);
+    result.p95 = percentile(0.95);
+    result.p99 = percentile(0.99);
+    result.max = sorted[count - 1] / 1e6;
+
+    return result;
+}
+
+const std::string& profiler::section::get_name() const {
+    return name;
+}
+
+profiler::scoped_timer::scoped_timer(section& s) : target(&s), start(clock::now()) {}
+
+profiler::scoped_timer::~scoped_timer() {
+    target->record(clock::now() - start);
+}
+
+auto profiler::get_section(const std::string& name) -> section& {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& ptr = sections_by_name[name];
+    if (!ptr) {
+        sections.push_back(std::make_unique<section>(name));
+        ptr = sections.back().get();
+    }
+    return *ptr;
+}
+
+auto profiler::get_stats(const std::string& name) const -> stats {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto iter = sections_by_name.find(name);
+    if (iter == sections_by_name.end()) {
+        return {};
+    }
+    return iter->second->get_stats();
+}
+
+auto profiler::get_sections() -> std::vector<section*> {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<section*> result;
+    result.reserve(sections.size());
+    for (const auto& s : sections) {
+        result.push_back(s.get());
+    }
+    return result;
+}
+
+namespace scripting {
+
+template <>
+void register_type<profiler>(sol::table& lua) {
+    lua.new_usertype<profiler>("profiler",
+        "stats", [](profiler& prof, const std::string& name, sol::this_state s) {
+            auto stats = prof.get_stats(name);
+            auto result = sol::state_view(s).create_table();
+            result["p50"] = stats.p50;
+            result["p95"] = stats.p95;
+            result["p99"] = stats.p99;
+            result["max"] = stats.max;
+            result["samples"] = stats.samples;
+            return result;
+        },
+        "sections", [](profiler& prof, sol::this_state s) {
+            auto result = sol::state_view(s).create_table();
+            auto i = 1;
+            for (auto section : prof.get_sections()) {
+                result[i++] = section->get_name();
+            }
+            return result;
+        });
+}
+
+} //namespace scripting
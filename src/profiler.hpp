@@ -0,0 +1,98 @@
+#ifndef LD42_PROFILER_HPP
+#define LD42_PROFILER_HPP
+
+#include "scripting.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class profiler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t sample_count = 256;
+
+    // Timing statistics of a section, in milliseconds.
+    struct stats {
+        double p50 = 0;
+        double p95 = 0;
+        double p99 = 0;
+        double max = 0;
+        std::size_t samples = 0;
+    };
+
+    class scoped_timer;
+
+    // Ring buffer of the most recent samples of a section.
+    //
+    // Writers claim a slot with a single atomic increment, so sections can be recorded from
+    // any thread without locking. Readers may observe a sample that is being overwritten,
+    // which only ever costs one stale sample.
+    class section {
+    public:
+        explicit section(std::string name);
+
+        void record(clock::duration duration);
+
+        // Records the time until the returned timer is destroyed.
+        scoped_timer time();
+
+        stats get_stats() const;
+
+        const std::string& get_name() const;
+
+    private:
+        std::string name;
+        std::array<std::atomic<std::int64_t>, sample_count> samples;
+        std::atomic<std::size_t> head;
+    };
+
+    class scoped_timer {
+    public:
+        explicit scoped_timer(section& s);
+        scoped_timer(const scoped_timer&) = delete;
+        scoped_timer& operator=(const scoped_timer&) = delete;
+        ~scoped_timer();
+
+    private:
+        section* target;
+        clock::time_point start;
+    };
+
+    profiler() = default;
+    profiler(const profiler&) = delete;
+    profiler& operator=(const profiler&) = delete;
+
+    // Finds or creates a section.
+    //
+    // This locks and looks the name up, so callers resolve their sections once and keep the
+    // reference, which stays valid for the life of the profiler.
+    section& get_section(const std::string& name);
+
+    // Statistics of a section, or empty statistics if there is no section by that name.
+    stats get_stats(const std::string& name) const;
+
+    // Sections in the order they were created.
+    std::vector<section*> get_sections();
+
+private:
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<section>> sections;
+    std::map<std::string, section*> sections_by_name;
+};
+
+namespace scripting {
+
+template <>
+void register_type<profiler>(sol::table& lua);
+
+} //namespace scripting
+
+#endif //LD42_PROFILER_HPP
@@ -12,6 +12,9 @@
 
 #include <sol.hpp>
 
+#include <fstream>
+#include <stdexcept>
+
 resource_manager::resource_manager(nlohmann::json& config, sol::state& lua) :
     mesh_cache([](const std::string& name) {
         return sushi::load_static_mesh_file("data/models/" + name + ".obj");
@@ -25,6 +28,15 @@ resource_manager::resource_manager(nlohmann::json& config, sol::state& lua) :
         file >> json;
         return std::make_shared<nlohmann::json>(json);
     }),
+    prefab_cache([](const std::string& name) {
+        std::ifstream file("data/prefabs/" + name + ".json");
+        if (!file) {
+            throw std::runtime_error("Failed to open prefab: " + name);
+        }
+        nlohmann::json json;
+        file >> json;
+        return prefab(json);
+    }),
     font_cache([](const std::string& fontname) {
         return msdf_font("data/fonts/" + fontname + ".ttf");
     }),
@@ -46,3 +58,45 @@ resource_manager::resource_manager(nlohmann::json& config, sol::state& lua) :
         return wav;
     })
 {}
+
+const script_handles& resource_manager::get_script_handles(component::script& script) {
+    if (script.handles && script.handles_generation == script_generation) {
+        return *script.handles;
+    }
+
+    auto iter = script_handle_cache.find(script.name);
+
+    if (iter == script_handle_cache.end()) {
+        auto& env = *environment_cache.get(script.name);
+        auto handles = script_handles{};
+        handles.update = env["update"];
+        handles.on_death = env["on_death"];
+        handles.on_collide = env["on_collide"];
+        handles.on_collide_batch = env["on_collide_batch"];
+        iter = script_handle_cache.emplace(script.name, std::move(handles)).first;
+    }
+
+    script.handles = &iter->second;
+    script.handles_generation = script_generation;
+
+    return *script.handles;
+}
+
+void resource_manager::reload_script(const std::string& name) {
+    pending_reloads.push_back(name);
+}
+
+void resource_manager::apply_script_reloads() {
+    if (pending_reloads.empty()) {
+        return;
+    }
+
+    for (const auto& name : pending_reloads) {
+        environment_cache.reload(name);
+    }
+    pending_reloads.clear();
+
+    // Components may point into the cache, the new generation makes them look up again.
+    script_handle_cache.clear();
+    ++script_generation;
+}
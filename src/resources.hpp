@@ -2,8 +2,10 @@
 #define LD42_RESOURCES_HPP
 
 #include "resource_cache.hpp"
+#include "components.hpp"
 #include "json.hpp"
 #include "font.hpp"
+#include "prefab.hpp"
 
 #include <sushi/mesh.hpp>
 #include <sushi/texture.hpp>
@@ -12,6 +14,19 @@
 
 #include <soloud_wav.h>
 
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*! A script's callbacks, looked up once per load of its environment. */
+struct script_handles {
+    sol::protected_function update;
+    sol::protected_function on_death;
+    sol::protected_function on_collide;
+    sol::protected_function on_collide_batch;
+};
+
 class resource_manager {
 public:
     resource_manager() = default;
@@ -22,13 +37,31 @@ public:
 
     resource_manager(nlohmann::json& config, sol::state& lua);
 
+    /*! Returns the callbacks of a script component's environment, caching them in the component. */
+    const script_handles& get_script_handles(component::script& script);
+
+    /*! Queues a script to be rerun by the next apply_script_reloads.
+     *
+     * Handlers may ask for a reload, so it cannot happen while one of them is running.
+     */
+    void reload_script(const std::string& name);
+
+    /*! Reruns the queued scripts and invalidates every cached script handle. */
+    void apply_script_reloads();
+
     resource_cache<sushi::static_mesh> mesh_cache;
     resource_cache<sushi::texture_2d> texture_cache;
     resource_cache<nlohmann::json> animation_cache;
+    resource_cache<prefab> prefab_cache;
     resource_cache<msdf_font> font_cache;
     resource_cache<sol::environment> environment_cache;
     resource_cache<SoLoud::Wav> sfx_cache;
     resource_cache<SoLoud::Wav> music_cache;
+
+private:
+    std::unordered_map<std::string, script_handles> script_handle_cache;
+    std::uint64_t script_generation = 1;
+    std::vector<std::string> pending_reloads;
 };
 
 #endif  // LD42_RESOURCES_HPP
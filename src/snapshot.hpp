@@ -0,0 +1,153 @@
+#ifndef LD42_SNAPSHOT_HPP
+#define LD42_SNAPSHOT_HPP
+
+#include <Meta.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// A copy of the whole world in one contiguous buffer, see ember_database::snapshot.
+// Values are stored in their in-memory layout, so a snapshot is only valid for the build that made it.
+struct world_snapshot {
+    std::vector<std::byte> data;
+};
+
+namespace snapshots {
+
+template <typename T>
+struct is_optional : std::false_type {};
+
+template <typename T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+template <typename T>
+struct is_array : std::false_type {};
+
+template <typename T, std::size_t N>
+struct is_array<std::array<T, N>> : std::true_type {};
+
+// Appends values to a snapshot. Trivially copyable values are copied as raw bytes, other
+// values are written member by member through Meta.
+class writer {
+public:
+    explicit writer(world_snapshot& snap) : data(snap.data) {}
+
+    template <typename T>
+    void write(const T& value) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            write_bytes(&value, sizeof(T));
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            write(std::uint64_t(value.size()));
+            write_bytes(value.data(), value.size());
+        } else if constexpr (is_optional<T>::value) {
+            write(bool(value));
+            if (value) {
+                write(*value);
+            }
+        } else if constexpr (is_array<T>::value) {
+            for (const auto& element : value) {
+                write(element);
+            }
+        } else {
+            static_assert(meta::isRegistered<T>(), "Type cannot be snapshotted.");
+            meta::doForAllMembers<T>([&](auto& member) {
+                write(member.get(value));
+            });
+        }
+    }
+
+    // Reserves space for a value to be filled in later, and returns its offset.
+    template <typename T>
+    std::size_t reserve() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        auto offset = data.size();
+        data.resize(offset + sizeof(T));
+        return offset;
+    }
+
+    template <typename T>
+    void write_at(std::size_t offset, const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        std::memcpy(data.data() + offset, &value, sizeof(T));
+    }
+
+private:
+    void write_bytes(const void* bytes, std::size_t size) {
+        auto offset = data.size();
+        data.resize(offset + size);
+        std::memcpy(data.data() + offset, bytes, size);
+    }
+
+    std::vector<std::byte>& data;
+};
+
+// Reads values back in the order a writer wrote them.
+class reader {
+public:
+    explicit reader(const world_snapshot& snap) : data(snap.data) {}
+
+    template <typename T>
+    void read(T& value) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            read_bytes(&value, sizeof(T));
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            auto size = read<std::uint64_t>();
+            check(size);
+            value.assign(reinterpret_cast<const char*>(data.data() + cursor), size);
+            cursor += size;
+        } else if constexpr (is_optional<T>::value) {
+            if (read<bool>()) {
+                value.emplace();
+                read(*value);
+            } else {
+                value.reset();
+            }
+        } else if constexpr (is_array<T>::value) {
+            for (auto& element : value) {
+                read(element);
+            }
+        } else {
+            static_assert(meta::isRegistered<T>(), "Type cannot be snapshotted.");
+            meta::doForAllMembers<T>([&](auto& member) {
+                using member_type = meta::get_member_type<decltype(member)>;
+                auto member_value = member_type{};
+                read(member_value);
+                member.set(value, std::move(member_value));
+            });
+        }
+    }
+
+    template <typename T>
+    T read() {
+        auto value = T{};
+        read(value);
+        return value;
+    }
+
+private:
+    void check(std::size_t size) const {
+        if (size > data.size() - cursor) {
+            throw std::runtime_error("Truncated world snapshot.");
+        }
+    }
+
+    void read_bytes(void* bytes, std::size_t size) {
+        check(size);
+        std::memcpy(bytes, data.data() + cursor, size);
+        cursor += size;
+    }
+
+    const std::vector<std::byte>& data;
+    std::size_t cursor = 0;
+};
+
+} //namespace snapshots
+
+#endif //LD42_SNAPSHOT_HPP
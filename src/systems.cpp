@@ -11,12 +11,41 @@
 #include <sushi/shader.hpp>
 #include <sushi/texture.hpp>
 
+#include <algorithm>
+#include <array>
 #include <iostream>
+#include <utility>
+#include <vector>
 
 namespace systems {
 
+namespace {
+
+struct collision_event {
+    ember_database::ent_id eid;
+    ember_database::ent_id other;
+    component::aabb region;
+};
+
+template <typename... Args>
+void call_handler(const sol::protected_function& func, Args&&... args) {
+    auto result = func(std::forward<Args>(args)...);
+    if (!result.valid()) {
+        sol::error err = result;
+        std::cerr << "ERROR: " << err.what() << std::endl;
+    }
+}
+
+} //namespace
+
 void movement(ld42_engine& engine, double delta) {
-    engine.entities.visit([&](component::position& pos, const component::velocity& vel) {
+    using DB = ember_database;
+    engine.entities.parallel_visit(*engine.jobs, [&](DB::ent_id eid, component::position& pos, const component::velocity& vel, ginseng::optional<component::previous_position> prev) {
+        if (prev) {
+            *prev = {pos.x, pos.y};
+        } else {
+            engine.entities.defer_create_component(eid, component::previous_position{pos.x, pos.y});
+        }
         pos.x += vel.vx * delta;
         pos.y += vel.vy * delta;
     });
@@ -25,200 +54,149 @@ void movement(ld42_engine& engine, double delta) {
 void collision(ld42_engine& engine, double delta) {
     using DB = ember_database;
 
-    struct entity_info {
-        DB::ent_id eid;
-        component::aabb aabb;
-    };
-
-    struct collision_manifold {
-        DB::ent_id eid1;
-        DB::ent_id eid2;
-        component::aabb region;
-    };
-
-    auto intersects = [](const component::aabb& a, const component::aabb& b) {
-        return a.left < b.right &&
-               b.left < a.right &&
-               a.bottom < b.top &&
-               b.top < a.bottom;
-    };
+    std::vector<broadphase::pair> collisions;
 
-    std::vector<entity_info> world;
-    std::vector<const entity_info*> axis_list;
-    std::vector<collision_manifold> collisions;
-
-    world.reserve(engine.entities.size());
-    axis_list.reserve(engine.entities.size());
-
-    // Create world list
-    engine.entities.visit([&](DB::ent_id eid, const component::position& pos, const component::aabb& aabb) {
-        auto info = entity_info{};
-        info.eid = eid;
-        info.aabb.left = pos.x + aabb.left;
-        info.aabb.right = pos.x + aabb.right;
-        info.aabb.bottom = pos.y + aabb.bottom;
-        info.aabb.top = pos.y + aabb.top;
-        world.push_back(info);
-    });
+    engine.spatial.update(engine.entities);
+    engine.spatial.find_pairs(collisions);
 
-    // Sort along X-axis
-    std::sort(begin(world), end(world), [](const entity_info& a, const entity_info& b) {
-        return a.aabb.left < a.aabb.right;
-    });
+    // Scripts with on_collide_batch get one call with all of their collisions for the frame.
+    std::vector<std::pair<component::script, std::vector<collision_event>>> batches;
 
-    // Sweep
-    for (const auto& info : world) {
-        // Prune
-        axis_list.erase(
-            std::remove_if(begin(axis_list), end(axis_list), [&](const auto& other_info) {
-                return other_info->aabb.right < info.aabb.left;
-            }),
-            end(axis_list));
-
-        // Check pairs
-        for (const auto& other_info : axis_list) {
-            auto manifold = collision_manifold{};
-            manifold.eid1 = info.eid;
-            manifold.eid2 = other_info->eid;
-            manifold.region.left = std::max(info.aabb.left, other_info->aabb.left);
-            manifold.region.right = std::min(info.aabb.right, other_info->aabb.right);
-            manifold.region.bottom = std::max(info.aabb.bottom, other_info->aabb.bottom);
-            manifold.region.top = std::min(info.aabb.top, other_info->aabb.top);
-
-            if (manifold.region.left < manifold.region.right && manifold.region.bottom < manifold.region.top) {
-                collisions.push_back(manifold);
+    auto deliver = [&](DB::ent_id eid, DB::ent_id other, const component::aabb& region) {
+        if (!engine.entities.has_component<component::script>(eid)) {
+            return;
+        }
+        auto& script = engine.entities.get_component<component::script>(eid);
+        const auto& handles = engine.resources.get_script_handles(script);
+        if (engine.batch_collisions && handles.on_collide_batch.valid()) {
+            auto iter = std::find_if(begin(batches), end(batches), [&](const auto& batch) {
+                return batch.first.name == script.name;
+            });
+            if (iter == end(batches)) {
+                batches.emplace_back(component::script{script.name}, std::vector<collision_event>{});
+                iter = end(batches) - 1;
             }
+            iter->second.push_back({eid, other, region});
+        } else if (handles.on_collide.valid()) {
+            call_handler(handles.on_collide, eid, other, region);
         }
-    }
+    };
 
     // Call handlers
     for (auto& collision : collisions) {
-        auto call_script = [&](DB::ent_id eid1, DB::ent_id eid2, const component::aabb& aabb) {
-            if (engine.entities.has_component<component::script>(eid1)) {
-                auto& script = engine.entities.get_component<component::script>(eid1);
-                auto script_ptr = engine.resources.environment_cache.get(script.name);
-                auto on_collide = (*script_ptr)["on_collide"];
-                if (on_collide.valid()) {
-                    on_collide(eid1, eid2, aabb);
-                }
-            }
-        };
-        call_script(collision.eid1, collision.eid2, collision.region);
-        call_script(collision.eid2, collision.eid1, collision.region);
+        deliver(collision.eid1, collision.eid2, collision.region);
+        deliver(collision.eid2, collision.eid1, collision.region);
+    }
+
+    for (auto& [script, events] : batches) {
+        auto table = engine.lua.create_table(int(events.size()), 0);
+        for (auto i = std::size_t{0}; i < events.size(); ++i) {
+            table[i + 1] = engine.lua.create_table_with(
+                "eid", events[i].eid,
+                "other", events[i].other,
+                "region", events[i].region);
+        }
+        call_handler(engine.resources.get_script_handles(script).on_collide_batch, table);
     }
 }
 
 void scripting(ld42_engine& engine, double delta) {
     using DB = ember_database;
-    engine.entities.visit([&](DB::ent_id eid, const component::script& script) {
-        auto update = (*engine.resources.environment_cache.get(script.name))["update"];
-        if (update.valid()) {
-            update(eid, delta);
+    engine.entities.visit([&](DB::ent_id eid, component::script& script) {
+        const auto& handles = engine.resources.get_script_handles(script);
+        if (handles.update.valid()) {
+            call_handler(handles.update, eid, delta);
         }
     });
 }
 
 void death_timer(ld42_engine& engine, double delta) {
     using DB = ember_database;
-    engine.entities.visit([&](DB::ent_id eid) {
-        if (engine.entities.has_component<component::death_timer>(eid)) {
-            auto& timer = engine.entities.get_component<component::death_timer>(eid);
-            timer.time -= delta;
-            if (timer.time <= 0) {
-                if (engine.entities.has_component<component::script>(eid)) {
-                    auto& script = engine.entities.get_component<component::script>(eid);
-                    auto env_ptr = engine.resources.environment_cache.get(script.name);
-                    auto on_death = (*env_ptr)["on_death"];
-                    if (on_death.valid()) {
-                        on_death(eid);
-                    }
+    engine.entities.visit([&](DB::ent_id eid, component::death_timer& timer) {
+        timer.time -= delta;
+        if (timer.time <= 0) {
+            if (engine.entities.has_component<component::script>(eid)) {
+                const auto& handles = engine.resources.get_script_handles(engine.entities.get_component<component::script>(eid));
+                if (handles.on_death.valid()) {
+                    call_handler(handles.on_death, eid);
                 }
-                engine.entities.destroy_entity(eid);
             }
+            engine.entities.defer_destroy_entity(eid);
         }
     });
 }
 
-void render(ld42_engine& engine, double delta) {
-    using namespace std::literals;
+void particles(ld42_engine& engine, double delta) {
     using DB = ember_database;
+    engine.entities.parallel_visit(*engine.jobs, [&](DB::ent_id eid, const component::position& pos, component::velocity& vel, component::particle& particle) {
+        vel.vx += particle.accel.x * delta;
+        vel.vy += particle.accel.y * delta;
+        particle.angle += particle.spin * delta;
 
-    auto proj = glm::ortho(-8.f, 56.f/3.f, -0.5f, 19.5f, 10.f, -10.f);
-    auto view = glm::mat4(1.f);
-    auto frustum = sushi::frustum(proj * view);
+        if (pos.y < -1.f) {
+            engine.entities.defer_destroy_entity(eid);
+        }
+    });
+}
+
+void draw(ld42_engine& engine, double alpha, draw_list& scene) {
+    using namespace std::literals;
+
+    scene.set_camera(glm::ortho(-8.f, 56.f/3.f, -0.5f, 19.5f, 10.f, -10.f), glm::mat4(1.f));
+
+    // Blends between the previous and current tick, for entities that have moved.
+    auto interpolate = [&](const component::position& pos, const ginseng::optional<component::previous_position>& prev) {
+        auto curr = glm::vec2(pos.x, pos.y);
+        if (prev) {
+            return glm::mix(glm::vec2(prev->x, prev->y), curr, float(alpha));
+        }
+        return curr;
+    };
 
     auto draw_block = [&](glm::vec2 pos, int color) {
-        auto piece_modelmat = glm::translate(glm::mat4(1), glm::vec3(pos, 0.f));
-        auto tint = glm::vec4{1, 1, 1, 1};
-
-        sushi::set_texture(0, *engine.resources.texture_cache.get("block_"s + std::to_string(color)));
-        sushi::set_uniform("normal_mat", glm::inverseTranspose(view * piece_modelmat));
-        sushi::set_uniform("MVP", (proj * view * piece_modelmat));
-        sushi::set_uniform("tint", tint);
-        sushi::draw_mesh(engine.sprite_mesh);
+        scene.add_sprite("block_"s + std::to_string(color), glm::translate(glm::mat4(1), glm::vec3(pos, 0.f)));
     };
 
-    engine.entities.visit([&](DB::ent_id eid, const component::position& pos, const component::shape& shape) {
+    // Queries, since each kind is a small fraction of the entities with a position.
+    engine.entities.visit_query<component::position, component::shape>([&](const component::position& pos, const component::shape& shape, ginseng::optional<component::previous_position> prev) {
         for (int i = 0; i < 4; ++i) {
-            auto xy = glm::vec2(pos.x, pos.y) + glm::vec2(shape.pieces[i]);
+            auto xy = interpolate(pos, prev) + glm::vec2(shape.pieces[i]);
             draw_block(xy, shape.colors[i]);
         }
     });
 
-    engine.entities.visit([&](DB::ent_id eid, const component::position& pos, const component::block& block) {
-        draw_block(glm::vec2(pos.x, pos.y), block.color);
+    engine.entities.visit_query<component::position, component::block>([&](const component::position& pos, const component::block& block, ginseng::optional<component::previous_position> prev) {
+        draw_block(interpolate(pos, prev), block.color);
     });
 
-    engine.entities.visit([&](DB::ent_id eid, const component::position& pos, component::velocity& vel, component::particle& particle) {
+    engine.entities.visit_query<component::position, component::particle>([&](const component::position& pos, const component::particle& particle, ginseng::optional<component::previous_position> prev) {
         auto modelmat = glm::mat4(1);
-        modelmat = glm::translate(modelmat, glm::vec3(pos.x, pos.y, 0.f));
+        modelmat = glm::translate(modelmat, glm::vec3(interpolate(pos, prev), 0.f));
         modelmat = glm::rotate(modelmat, particle.angle, glm::vec3(0.f, 0.f, 1.f));
         modelmat = glm::scale(modelmat, glm::vec3(0.5f, 0.5f, 0.5f));
-        auto tint = glm::vec4{1, 1, 1, 1};
 
-        sushi::set_texture(0, *engine.resources.texture_cache.get("block_"s + std::to_string(particle.color)));
-        sushi::set_uniform("normal_mat", glm::inverseTranspose(view * modelmat));
-        sushi::set_uniform("MVP", (proj * view * modelmat));
-        sushi::set_uniform("tint", tint);
-        sushi::draw_mesh(engine.sprite_mesh);
-
-        vel.vx += particle.accel.x * delta;
-        vel.vy += particle.accel.y * delta;
-        particle.angle += particle.spin * delta;
-
-        if (pos.y < -1.f) {
-            engine.entities.destroy_entity(eid);
-        }
+        scene.add_sprite("block_"s + std::to_string(particle.color), modelmat);
     });
 }
 
 void board_tick(ld42_engine& engine, double delta) {
+    struct broken_block {
+        component::position pos;
+        int color;
+    };
+
+    std::vector<broken_block> broken;
+
     auto break_block = [&](ember_database::net_id nid) {
         auto eid = engine.entities.get_entity(nid);
         const auto& pos = engine.entities.get_component<component::position>(eid);
         const auto& block = engine.entities.get_component<component::block>(eid);
 
-        auto spawn_particle = [&](const component::velocity& vel) {
-            auto particle = engine.entities.create_entity();
-            engine.entities.create_component(particle, component::position{pos});
-            engine.entities.create_component(particle, component::velocity{vel});
-            engine.entities.create_component(particle, component::particle{
-                {0.f, -15.f},
-                0.f,
-                3.f,
-                block.color
-            });
-        };
-
-        spawn_particle({-3.f, 3.f});
-        spawn_particle({-3.f, -3.f});
-        spawn_particle({3.f, -3.f});
-        spawn_particle({3.f, 3.f});
+        broken.push_back({pos, block.color});
 
-        engine.entities.destroy_entity(eid);
+        engine.entities.defer_destroy_entity(eid);
     };
 
-
     engine.entities.visit([&](ember_database::ent_id eid, component::board& board) {
         auto check_matches = [&] {
             int score = 0;
@@ -238,8 +216,9 @@ void board_tick(ld42_engine& engine, double delta) {
                     for (int oy = y + 1; oy < 22; ++oy) {
                         for (auto& nid : board.grid[oy]) {
                             if (nid) {
-                                auto& pos = engine.entities.get_component<component::position>(engine.entities.get_entity(*nid));
-                                pos.y -= 1;
+                                auto above = engine.entities.get_entity(*nid);
+                                engine.entities.get_component<component::position>(above).y -= 1;
+                                engine.entities.mark_changed<component::position>(above);
                             }
                         }
                         board.grid[oy - 1] = std::move(board.grid[oy]);
@@ -320,8 +299,9 @@ void board_tick(ld42_engine& engine, double delta) {
                             break_block(*board.grid[y][x]);
                             for (int oy = y + 1; oy < 22; ++oy) {
                                 if (board.grid[oy][x]) {
-                                    auto& pos = engine.entities.get_component<component::position>(engine.entities.get_entity(*board.grid[oy][x]));
-                                    pos.y -= 1;
+                                    auto above = engine.entities.get_entity(*board.grid[oy][x]);
+                                    engine.entities.get_component<component::position>(above).y -= 1;
+                                    engine.entities.mark_changed<component::position>(above);
                                 }
                                 board.grid[oy - 1][x] = std::move(board.grid[oy][x]);
                             }
@@ -336,10 +316,10 @@ void board_tick(ld42_engine& engine, double delta) {
 
         auto spawn_next = [&] {
             auto shape = get_random_shape(engine.rng, engine.bag);
-            auto active = engine.entities.create_entity();
-            engine.entities.create_component(active, component::position{4, 19});
-            engine.entities.create_component(active, shape);
-            board.active = engine.entities.get_component<component::net_id>(active).id;
+            auto active = engine.entities.defer_create_entity();
+            engine.entities.defer_create_component(active, component::position{4, 19});
+            engine.entities.defer_create_component(active, shape);
+            board.active = active;
 
             for (int i = 0; i < 4; ++i) {
                 auto x = 4 + shape.pieces[i].x;
@@ -357,6 +337,7 @@ void board_tick(ld42_engine& engine, double delta) {
             auto active = engine.entities.get_entity(*board.active);
             auto& pos = engine.entities.get_component<component::position>(active);
             auto& shape = engine.entities.get_component<component::shape>(active);
+            engine.entities.mark_changed<component::position>(active);  // Moved through pos below.
             auto nid = engine.entities.get_component<component::net_id>(active).id;
 
             // Movement
@@ -371,19 +352,21 @@ void board_tick(ld42_engine& engine, double delta) {
                 return true;
             };
 
-            if (engine.input_table.get_or("left_repeat", false) && can_move(-1)) {
+            const auto& actions = engine.actions;
+
+            if (actions[input::action::left].repeat && can_move(-1)) {
                 pos.x -= 1;
             }
 
-            if (engine.input_table.get_or("right_repeat", false) && can_move(1)) {
+            if (actions[input::action::right].repeat && can_move(1)) {
                 pos.x += 1;
             }
 
             // Rotation
-            if (engine.input_table["rotate_cw_pressed"] || engine.input_table["rotate_ccw_pressed"]) {
+            if (actions[input::action::rotate_cw].pressed || actions[input::action::rotate_ccw].pressed) {
                 auto new_shape = shape;
                 glm::mat2 rotmat;
-                if (engine.input_table["rotate_cw_pressed"]) {
+                if (actions[input::action::rotate_cw].pressed) {
                     rotmat = glm::mat2({0.f, -1.f}, {1.f, 0.f});
                 } else {
                     rotmat = glm::mat2({0.f, 1.f}, {-1.f, 0.f});
@@ -407,12 +390,12 @@ void board_tick(ld42_engine& engine, double delta) {
             }
 
             // Hard drop
-            if (engine.input_table.get_or("up_pressed", false)) {
+            if (actions[input::action::up].pressed) {
             }
 
             board.next_tick -= delta;
 
-            if (engine.input_table.get_or("down", false) && engine.get_tick_delay() - board.next_tick > 1.0/30.0) {
+            if (actions[input::action::down].down && engine.get_tick_delay() - board.next_tick > 1.0/30.0) {
                 board.next_tick = 0.0;
             }
 
@@ -428,15 +411,14 @@ void board_tick(ld42_engine& engine, double delta) {
                 };
 
                 if (should_lock()) {
+                    // Locked blocks are created right away, line clearing below needs to find them.
                     for (int i = 0; i < 4; ++i) {
                         auto x = pos.x + shape.pieces[i].x;
                         auto y = pos.y + shape.pieces[i].y;
-                        auto block = engine.entities.create_entity();
-                        engine.entities.create_component(block, component::position{x, y});
-                        engine.entities.create_component(block, component::block{shape.colors[i]});
+                        auto block = engine.entities.create_entity_with(component::position{x, y}, component::block{shape.colors[i]});
                         board.grid[y][x] = engine.entities.get_component<component::net_id>(block).id;
                     }
-                    engine.entities.destroy_entity(active);
+                    engine.entities.defer_destroy_entity(active);
 
                     board.active = std::nullopt;
 
@@ -448,7 +430,7 @@ void board_tick(ld42_engine& engine, double delta) {
                     } else {
                         engine.play_sfx("placement");
                         if (!spawn_next()) {
-                            engine.entities.destroy_entity(eid);
+                            engine.entities.defer_destroy_entity(eid);
                             engine.play_sfx("death");
                         }
                         engine.combo = 0;
@@ -469,7 +451,7 @@ void board_tick(ld42_engine& engine, double delta) {
                     board.next_tick = 0.5;
                 } else {
                     if (!spawn_next()) {
-                        engine.entities.destroy_entity(eid);
+                        engine.entities.defer_destroy_entity(eid);
                         engine.play_sfx("death");
                     }
                     board.next_tick = engine.get_tick_delay();
@@ -478,6 +460,35 @@ void board_tick(ld42_engine& engine, double delta) {
             }
         }
     });
+
+    // Four particles per broken block, created in one batch.
+    // Particles start with every component movement will give them, so they never change archetype.
+    if (!broken.empty()) {
+        static const std::array<component::velocity, 4> velocities = {{
+            {-3.f, 3.f},
+            {-3.f, -3.f},
+            {3.f, -3.f},
+            {3.f, 3.f},
+        }};
+
+        engine.entities.create_entities(broken.size() * velocities.size(),
+            [&](std::size_t i, component::position& pos, component::previous_position& prev, component::velocity& vel, component::particle& particle) {
+                const auto& block = broken[i / velocities.size()];
+                pos = block.pos;
+                prev = {pos.x, pos.y};
+                vel = velocities[i % velocities.size()];
+                particle.color = block.color;
+            },
+            component::position{},
+            component::previous_position{},
+            component::velocity{},
+            component::particle{
+                {0.f, -15.f},
+                0.f,
+                3.f,
+                0
+            });
+    }
 }
 
 }  //namespace systems
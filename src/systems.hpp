@@ -2,6 +2,7 @@
 #define LD42_SYSTEMS_HPP
 
 #include "engine.hpp"
+#include "draw_list.hpp"
 
 namespace systems {
 
@@ -9,7 +10,8 @@ void movement(ld42_engine& engine, double delta);
 void collision(ld42_engine& engine, double delta);
 void scripting(ld42_engine& engine, double delta);
 void death_timer(ld42_engine& engine, double delta);
-void render(ld42_engine& engine, double delta);
+void particles(ld42_engine& engine, double delta);
+void draw(ld42_engine& engine, double alpha, draw_list& scene);
 void board_tick(ld42_engine& engine, double delta);
 
 } //namespace systems
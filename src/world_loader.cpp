@@ -0,0 +1,85 @@
+#include "world_loader.hpp"
+
+#include "components.hpp"
+#include "component_scripting.hpp"
+#include "utility.hpp"
+
+#include <iostream>
+#include <unordered_map>
+
+namespace world_loader {
+
+namespace {
+
+using create_fn = void (*)(ember_database& db, ember_database::ent_id eid, const nlohmann::json& value);
+
+template <typename... Coms>
+std::unordered_map<std::string, create_fn> make_component_table(utility::type_list<Coms...>) {
+    return {
+        {meta::getName<Coms>(), [](ember_database& db, ember_database::ent_id eid, const nlohmann::json& value) {
+            db.create_component(eid, value.get<Coms>());
+        }}...
+    };
+}
+
+const std::unordered_map<std::string, create_fn>& get_component_table() {
+    static const auto table = make_component_table(component::all_components{});
+    return table;
+}
+
+} //namespace
+
+bool create_component(ember_database& db, ember_database::ent_id eid, const std::string& name, const nlohmann::json& value) {
+    const auto& table = get_component_table();
+    auto iter = table.find(name);
+
+    if (iter == table.end()) {
+        return false;
+    }
+
+    iter->second(db, eid, value);
+    return true;
+}
+
+ember_database::ent_id load_entity(ember_database& db, const nlohmann::json& data, const fallback& unknown) {
+    auto net_id = data.find("net_id");
+    auto eid = net_id != data.end()
+        ? db.create_entity(net_id->at("id").get<ember_database::net_id>())
+        : db.create_entity();
+
+    for (auto iter = data.begin(); iter != data.end(); ++iter) {
+        if (iter.key() == "net_id") {
+            continue;
+        }
+
+        if (!create_component(db, eid, iter.key(), iter.value())) {
+            if (unknown) {
+                unknown(eid, iter.key(), iter.value());
+            } else {
+                std::clog << "Warning: Unknown component " << iter.key() << "!" << std::endl;
+            }
+        }
+    }
+
+    return eid;
+}
+
+std::size_t load_world(ember_database& db, std::istream& in, const fallback& unknown) {
+    using parse_event = nlohmann::json::parse_event_t;
+
+    auto count = std::size_t{0};
+
+    // Entities are the objects directly inside the top-level array.
+    nlohmann::json::parse(in, [&](int depth, parse_event event, nlohmann::json& parsed) {
+        if (depth == 1 && event == parse_event::object_end) {
+            load_entity(db, parsed, unknown);
+            ++count;
+            return false;
+        }
+        return true;
+    });
+
+    return count;
+}
+
+} //namespace world_loader
@@ -0,0 +1,36 @@
+#ifndef LD42_WORLD_LOADER_HPP
+#define LD42_WORLD_LOADER_HPP
+
+#include "entities.hpp"
+#include "json.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <string>
+
+// Native world loading.
+//
+// Builds entities from JSON objects that map component names to values, constructing the
+// components directly in the database. Names come from the component REGISTER declarations.
+// Components without a native entry, such as ones defined by scripts, go to a fallback.
+namespace world_loader {
+
+using fallback = std::function<void(ember_database::ent_id eid, const std::string& name, const nlohmann::json& value)>;
+
+// Creates a component from its JSON value, returns false if the name has no native entry.
+bool create_component(ember_database& db, ember_database::ent_id eid, const std::string& name, const nlohmann::json& value);
+
+// Creates an entity from a JSON object, under its "net_id" if it has one.
+ember_database::ent_id load_entity(ember_database& db, const nlohmann::json& data, const fallback& unknown);
+
+// Loads a world from a JSON array of entities.
+//
+// The stream is parsed incrementally, and each entity is created and discarded as soon as its
+// object is complete, so memory use is bounded by the largest entity rather than the file.
+// Returns the number of entities loaded.
+std::size_t load_world(ember_database& db, std::istream& in, const fallback& unknown);
+
+} //namespace world_loader
+
+#endif //LD42_WORLD_LOADER_HPP
@@ -4,5 +4,48 @@ var EmberConfig = {
         width: 640,
         height: 480
     },
+    simulation: {
+        tick_rate: 60,
+        max_ticks_per_frame: 5,
+        pipelined: false
+    },
+    input: {
+        repeat_delay: 0.1,
+        bindings: {
+            left: ["Left"],
+            right: ["Right"],
+            up: ["Up"],
+            down: ["Down"],
+            shoot: ["Space"],
+            rotate_cw: ["X", "F", "Space"],
+            rotate_ccw: ["Z", "W", "Y", "Q"],
+            restart: ["R"],
+            music: ["M"]
+        }
+    },
+    pacing: {
+        vsync: "on",
+        target_fps: 0,
+        spin_us: 1500,
+        idle_timeout_ms: 250
+    },
+    lua_gc: {
+        mode: "incremental",
+        budget_us: 1000,
+        step_kb: 8,
+        emergency_multiplier: 4
+    },
+    entities: {
+        storage: "sparse",
+        compact_each_tick: true
+    },
+    collision: {
+        broadphase: "sap",
+        cell_size: 2.0,
+        batch_callbacks: false
+    },
+    jobs: {
+        threads: -1
+    },
     volume: 1.0
 };
@@ -0,0 +1,88 @@
+#include "check.hpp"
+
+#include "binary_serializer.hpp"
+#include "components.hpp"
+#include "entities.hpp"
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+struct position_as_ints {
+    int x = 0;
+    int y = 0;
+};
+
+} //namespace
+
+namespace meta {
+
+// Same name and members as component::position, but a different member type.
+template <> constexpr auto registerName<position_as_ints>() {
+    return "position";
+}
+
+template <> inline auto registerMembers<position_as_ints>() {
+    return members(
+        member("x", &position_as_ints::x),
+        member("y", &position_as_ints::y));
+}
+
+} //namespace meta
+
+namespace {
+
+void round_trip() {
+    auto db = ember_database{};
+    auto eid = db.create_entity();
+    db.create_component(eid, component::position{1.5f, -2});
+    db.create_component(eid, component::script{"player"});
+    auto board = component::board{};
+    board.grid[21][9] = 42;
+    db.create_component(eid, board);
+    auto id = db.get_component<component::net_id>(eid).id;
+
+    auto bytes = binary::save_world(db, component::all_components{});
+
+    auto loaded = ember_database{};
+    LD42_CHECK(binary::load_world(loaded, bytes, component::all_components{}) == 1);
+    auto loaded_eid = loaded.find_entity(id);
+    LD42_CHECK(loaded_eid);
+    LD42_CHECK(loaded.get_component<component::position>(*loaded_eid).x == 1.5f);
+    LD42_CHECK(loaded.get_component<component::position>(*loaded_eid).y == -2);
+    LD42_CHECK(loaded.get_component<component::script>(*loaded_eid).name == "player");
+    LD42_CHECK(loaded.get_component<component::board>(*loaded_eid).grid[21][9] == 42);
+    LD42_CHECK(!loaded.has_component<component::velocity>(*loaded_eid));
+}
+
+void member_types_are_fingerprinted() {
+    LD42_CHECK(binary::_detail::fingerprint<position_as_ints>() != binary::_detail::fingerprint<component::position>());
+}
+
+void counts_are_bounded() {
+    auto bytes = std::vector<std::byte>{};
+    auto out = binary::writer(bytes);
+    out.write_bytes(binary::world_magic.data(), binary::world_magic.size());
+    out.write_varint(binary::format_version);
+    out.write_varint(std::uint64_t(1) << 40);
+
+    auto db = ember_database{};
+    auto threw = false;
+    try {
+        binary::load_world(db, bytes, component::all_components{});
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    LD42_CHECK(threw);
+}
+
+} //namespace
+
+int main() {
+    round_trip();
+    member_types_are_fingerprinted();
+    counts_are_bounded();
+    std::cout << "binary_serializer: ok" << std::endl;
+}
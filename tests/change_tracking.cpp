@@ -0,0 +1,167 @@
+#include "check.hpp"
+
+#include "broadphase.hpp"
+#include "components.hpp"
+#include "entities.hpp"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using DB = ember_database;
+
+std::vector<DB::ent_id> changed_since(DB& db, std::uint64_t since) {
+    auto visited = std::vector<DB::ent_id>();
+    db.visit_changed_since(since, [&](DB::ent_id eid, const component::position&) {
+        visited.push_back(eid);
+    });
+    return visited;
+}
+
+void stamps() {
+    auto db = DB{};
+    db.track_changes<component::position>();
+
+    auto a = db.create_entity();
+    auto b = db.create_entity();
+    auto c = db.create_entity();
+    db.create_component(a, component::position{});
+    db.create_component(b, component::position{});
+    db.create_component(c, component::velocity{});
+
+    LD42_CHECK(changed_since(db, 1).size() == 2);
+
+    db.advance_change_tick();
+    auto since = db.get_change_tick();
+    LD42_CHECK(changed_since(db, since).empty());
+
+    // Const visits are reads, mutable ones are writes.
+    db.visit([](const component::position&) {});
+    LD42_CHECK(changed_since(db, since).empty());
+
+    db.get_component<component::position>(b).x = 1;
+    db.mark_changed<component::position>(b);
+    auto changed = changed_since(db, since);
+    LD42_CHECK(changed.size() == 1 && changed[0].get_index() == b.get_index());
+    LD42_CHECK(db.get_change_stamp<component::position>(a) == 1);
+    LD42_CHECK(db.get_change_stamp<component::position>(b) == since);
+
+    db.advance_change_tick();
+    since = db.get_change_tick();
+    db.visit([](component::position& pos) { pos.y += 1; });
+    LD42_CHECK(changed_since(db, since).size() == 2);
+    LD42_CHECK(db.get_change_stamp<component::velocity>(c) == 0);
+}
+
+std::set<std::pair<std::uint32_t, std::uint32_t>> brute_force(DB& db) {
+    auto boxes = std::vector<std::pair<DB::ent_id, component::aabb>>();
+    db.visit([&](DB::ent_id eid, const component::position& pos, const component::aabb& box) {
+        boxes.push_back({eid, {pos.x + box.left, pos.x + box.right, pos.y + box.bottom, pos.y + box.top}});
+    });
+
+    auto pairs = std::set<std::pair<std::uint32_t, std::uint32_t>>();
+    for (auto i = std::size_t{0}; i < boxes.size(); ++i) {
+        for (auto j = i + 1; j < boxes.size(); ++j) {
+            const auto& a = boxes[i].second;
+            const auto& b = boxes[j].second;
+            if (std::max(a.left, b.left) < std::min(a.right, b.right) &&
+                std::max(a.bottom, b.bottom) < std::min(a.top, b.top)) {
+                pairs.insert(std::minmax(boxes[i].first.get_index(), boxes[j].first.get_index()));
+            }
+        }
+    }
+    return pairs;
+}
+
+// The broadphase only moves proxies whose boxes changed, so every way of changing one must show up.
+void broadphase_sync(const char* mode) {
+    auto db = DB{};
+    auto phase = broadphase(nlohmann::json{{"broadphase", mode}, {"cell_size", 2.0}});
+    auto rng = std::mt19937{3};
+    auto coord = std::uniform_real_distribution<float>(-10, 10);
+
+    auto spawn = [&] {
+        auto eid = db.create_entity();
+        db.create_component(eid, component::position{coord(rng), coord(rng)});
+        db.create_component(eid, component::aabb{-1, 1, -1, 1});
+        return eid;
+    };
+
+    for (int i = 0; i < 200; ++i) {
+        spawn();
+    }
+
+    for (int tick = 0; tick < 30; ++tick) {
+        auto live = std::vector<DB::ent_id>();
+        db.visit([&](DB::ent_id eid, const component::aabb&) {
+            live.push_back(eid);
+        });
+        std::shuffle(live.begin(), live.end(), rng);
+
+        switch (tick % 5) {
+            case 0:
+                db.visit([&](DB::ent_id eid, component::position& pos) {
+                    if (eid.get_index() % 7 == tick % 7) {
+                        pos.x += 1;
+                    }
+                });
+                break;
+            case 1:
+                for (auto i = 0; i < 5; ++i) {
+                    db.get_component<component::position>(live[i]).y = coord(rng);
+                    db.mark_changed<component::position>(live[i]);
+                }
+                break;
+            case 2:
+                // Destroyed entities' indices are reused by the new ones.
+                for (auto i = 0; i < 10; ++i) {
+                    db.destroy_entity(live[i]);
+                }
+                for (auto i = 0; i < 10; ++i) {
+                    spawn();
+                }
+                break;
+            case 3:
+                db.destroy_component<component::aabb>(live[0]);
+                db.destroy_component<component::position>(live[1]);
+                db.create_component(live[2], component::aabb{-3, 3, -3, 3});
+                break;
+            case 4:
+                db.visit([](component::aabb& box) {
+                    box.right += 0.1f;
+                });
+                break;
+        }
+
+        phase.sync(db);
+        auto out = std::vector<broadphase::pair>();
+        phase.find_pairs(out);
+
+        auto found = std::set<std::pair<std::uint32_t, std::uint32_t>>();
+        for (const auto& p : out) {
+            found.insert(std::minmax(p.eid1.get_index(), p.eid2.get_index()));
+        }
+
+        LD42_CHECK(found.size() == out.size());
+        LD42_CHECK(found == brute_force(db));
+
+        auto boxes = std::size_t{0};
+        db.visit([&](const component::position&, const component::aabb&) { ++boxes; });
+        LD42_CHECK(phase.size() == boxes);
+
+        db.advance_change_tick();
+    }
+}
+
+} //namespace
+
+int main() {
+    stamps();
+    broadphase_sync("sap");
+    broadphase_sync("grid");
+    std::cout << "change_tracking: ok" << std::endl;
+}
@@ -0,0 +1,16 @@
+#ifndef LD42_TESTS_CHECK_HPP
+#define LD42_TESTS_CHECK_HPP
+
+#include <cstdlib>
+#include <iostream>
+
+// Like assert, but also checked in release builds.
+#define LD42_CHECK(EXPR)                                                                     \
+    do {                                                                                     \
+        if (!(EXPR)) {                                                                       \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": Check failed: " #EXPR << std::endl; \
+            std::exit(EXIT_FAILURE);                                                         \
+        }                                                                                    \
+    } while (false)
+
+#endif //LD42_TESTS_CHECK_HPP
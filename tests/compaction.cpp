@@ -0,0 +1,157 @@
+#include "check.hpp"
+
+#include "components.hpp"
+#include "entities.hpp"
+
+#include <map>
+#include <optional>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using DB = ember_database;
+
+// What each live entity should hold, by net_id.
+struct expected {
+    component::position pos;
+    std::optional<component::velocity> vel;
+};
+
+struct churned_world {
+    DB db;
+    std::map<DB::net_id, expected> model;
+    std::vector<DB::net_id> ids;
+    std::mt19937 rng{7};
+    int serial = 0;
+
+    void spawn() {
+        auto eid = db.create_entity();
+        auto e = expected{component::position{float(serial), float(-serial)}, std::nullopt};
+        db.create_component(eid, e.pos);
+        if (serial % 3 != 0) {
+            e.vel = component::velocity{float(serial % 17), 1};
+            db.create_component(eid, *e.vel);
+        }
+        ++serial;
+        auto id = db.get_component<component::net_id>(eid).id;
+        model[id] = e;
+        ids.push_back(id);
+    }
+
+    void destroy_some(std::size_t count) {
+        for (std::size_t i = 0; i < count && !ids.empty(); ++i) {
+            auto pick = rng() % ids.size();
+            std::swap(ids[pick], ids.back());
+            db.destroy_entity(ids.back());
+            model.erase(ids.back());
+            ids.pop_back();
+        }
+    }
+
+    void churn(int live, int rounds) {
+        while (int(model.size()) < live * 2) {
+            spawn();
+        }
+        for (int round = 0; round < rounds; ++round) {
+            destroy_some(model.size() / 2);
+            while (int(model.size()) < live) {
+                spawn();
+            }
+        }
+    }
+
+    void check() {
+        for (const auto& [id, e] : model) {
+            auto eid = db.find_entity(id);
+            LD42_CHECK(eid);
+            const auto& pos = db.get_component<component::position>(*eid);
+            LD42_CHECK(pos.x == e.pos.x && pos.y == e.pos.y);
+            LD42_CHECK(db.has_component<component::velocity>(*eid) == bool(e.vel));
+            if (e.vel) {
+                const auto& vel = db.get_component<component::velocity>(*eid);
+                LD42_CHECK(vel.vx == e.vel->vx && vel.vy == e.vel->vy);
+            }
+        }
+
+        auto positions = std::size_t{0};
+        db.visit([&](const component::position&) { ++positions; });
+        LD42_CHECK(positions == model.size());
+
+        auto moving = std::set<DB::net_id>();
+        for (const auto& [id, e] : model) {
+            if (e.vel) {
+                moving.insert(id);
+            }
+        }
+
+        auto visited = std::set<DB::net_id>();
+        db.visit_query<component::position, component::velocity>(
+            [&](DB::ent_id eid, const component::position& pos, const component::velocity& vel) {
+                auto& e = model.at(db.get_component<component::net_id>(eid).id);
+                LD42_CHECK(pos.x == e.pos.x && e.vel && vel.vx == e.vel->vx);
+                visited.insert(db.get_component<component::net_id>(eid).id);
+            });
+        LD42_CHECK(visited == moving);
+        LD42_CHECK((db.query_size<component::position, component::velocity>() == moving.size()));
+    }
+
+    std::size_t free_slots() {
+        auto free = std::size_t{0};
+        for (const auto& set : db.memory_report().component_sets) {
+            free += set.free_slots;
+        }
+        return free;
+    }
+};
+
+void full_compaction() {
+    auto world = churned_world{};
+    world.db.query_size<component::position, component::velocity>();
+    world.churn(5000, 6);
+    world.check();
+
+    world.db.compact();
+    world.check();
+    LD42_CHECK(world.free_slots() == 0);
+
+    world.churn(5000, 2);
+    world.check();
+}
+
+// Steps are interleaved with creation and destruction, like ticks would be.
+void incremental_compaction() {
+    auto world = churned_world{};
+    world.db.query_size<component::position, component::velocity>();
+    world.churn(20000, 6);
+    world.check();
+
+    auto steps = 0;
+    while (world.db.compact_step()) {
+        ++steps;
+        LD42_CHECK(steps < 1000);
+        world.destroy_some(5);
+        for (int i = 0; i < 5; ++i) {
+            world.spawn();
+        }
+        if (steps % 10 == 0) {
+            world.check();
+        }
+    }
+    world.check();
+    LD42_CHECK(steps > 1);
+
+    world.db.compact();
+    world.check();
+    LD42_CHECK(world.free_slots() == 0);
+}
+
+} //namespace
+
+int main() {
+    full_compaction();
+    incremental_compaction();
+    std::cout << "compaction: ok" << std::endl;
+}
@@ -0,0 +1,74 @@
+#include "check.hpp"
+
+#include "job_system.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+void ordering(int workers) {
+    auto jobs = job_system(workers);
+    auto graph = job_system::task_graph{};
+
+    // A diamond: a before b and c, both before d.
+    auto order = std::vector<std::atomic<int>>(4);
+    auto counter = std::atomic<int>(0);
+    auto a = graph.add([&] { order[0] = counter++; });
+    auto b = graph.add([&] { order[1] = counter++; });
+    auto c = graph.add([&] { order[2] = counter++; });
+    auto d = graph.add([&] { order[3] = counter++; });
+    graph.precede(a, b);
+    graph.precede(a, c);
+    graph.precede(b, d);
+    graph.precede(c, d);
+
+    jobs.run(graph);
+
+    LD42_CHECK(counter == 4);
+    LD42_CHECK(order[0] == 0);
+    LD42_CHECK(order[3] == 3);
+}
+
+void throwing_node(int workers) {
+    auto jobs = job_system(workers);
+    auto graph = job_system::task_graph{};
+
+    auto after_ran = std::atomic<bool>(false);
+    auto independent = std::atomic<int>(0);
+    auto thrower = graph.add([] { throw std::runtime_error("node failed"); });
+    auto after = graph.add([&] { after_ran = true; });
+    graph.precede(thrower, after);
+    for (int i = 0; i < 16; ++i) {
+        graph.add([&] { ++independent; });
+    }
+
+    auto message = std::string();
+    try {
+        jobs.run(graph);
+    } catch (const std::runtime_error& e) {
+        message = e.what();
+    }
+
+    LD42_CHECK(message == "node failed");
+    LD42_CHECK(!after_ran);
+
+    // The pool is still usable afterwards.
+    auto sum = std::atomic<int>(0);
+    jobs.parallel_for(0, 100, 10, [&](std::size_t first, std::size_t last) {
+        sum += int(last - first);
+    });
+    LD42_CHECK(sum == 100);
+}
+
+} //namespace
+
+int main() {
+    for (auto workers : {0, 1, 4}) {
+        ordering(workers);
+        throwing_node(workers);
+    }
+    std::cout << "job_system: ok" << std::endl;
+}
@@ -0,0 +1,75 @@
+#include "check.hpp"
+
+#include "components.hpp"
+#include "entities.hpp"
+
+#include <string>
+
+namespace {
+
+void round_trip(bool archetypes) {
+    auto db = ember_database{};
+    db.enable_archetypes(archetypes);
+
+    auto plain = db.create_entity();
+    db.create_component(plain, component::position{1, 2});
+    db.create_component(plain, component::script{"player"});
+    db.create_component(plain, component::animation{"hero", "walk", 3});
+
+    auto board = component::board{};
+    board.grid[4][2] = 7;
+    board.active = 9;
+    auto with_board = db.create_entity();
+    db.create_component(with_board, board);
+
+    auto chunked = db.create_entity_with(component::position{5, 6}, component::velocity{1, -1});
+
+    auto plain_id = db.get_component<component::net_id>(plain).id;
+    auto board_id = db.get_component<component::net_id>(with_board).id;
+    auto chunked_id = db.get_component<component::net_id>(chunked).id;
+
+    auto snap = db.snapshot(component::all_components{});
+
+    // Everything below is undone by the restore, including the pending command.
+    db.get_component<component::position>(plain).x = 100;
+    db.destroy_entity(with_board);
+    auto extra = db.create_entity();
+    auto extra_id = db.get_component<component::net_id>(extra).id;
+    db.defer_destroy_entity(plain);
+
+    db.restore(snap, component::all_components{});
+    db.flush_deferred();
+
+    LD42_CHECK(!db.find_entity(extra_id));
+
+    auto restored_plain = db.find_entity(plain_id);
+    LD42_CHECK(restored_plain);
+    LD42_CHECK(db.get_component<component::position>(*restored_plain).x == 1);
+    LD42_CHECK(db.get_component<component::position>(*restored_plain).y == 2);
+    LD42_CHECK(db.get_component<component::script>(*restored_plain).name == "player");
+    LD42_CHECK(db.get_component<component::animation>(*restored_plain).cycle == "walk");
+    LD42_CHECK(db.get_component<component::animation>(*restored_plain).frame == 3);
+    LD42_CHECK(!db.has_component<component::velocity>(*restored_plain));
+
+    auto restored_board = db.find_entity(board_id);
+    LD42_CHECK(restored_board);
+    LD42_CHECK(db.get_component<component::board>(*restored_board).grid[4][2] == 7);
+    LD42_CHECK(db.get_component<component::board>(*restored_board).active == 9);
+
+    auto restored_chunked = db.find_entity(chunked_id);
+    LD42_CHECK(restored_chunked);
+    LD42_CHECK(db.get_component<component::position>(*restored_chunked).x == 5);
+    LD42_CHECK(db.get_component<component::velocity>(*restored_chunked).vy == -1);
+
+    // New entities must not reuse the net_ids handed out before the snapshot.
+    auto fresh = db.create_entity();
+    LD42_CHECK(db.get_component<component::net_id>(fresh).id == extra_id);
+}
+
+} //namespace
+
+int main() {
+    round_trip(false);
+    round_trip(true);
+    std::cout << "snapshot: ok" << std::endl;
+}